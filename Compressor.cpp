@@ -4,23 +4,27 @@
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
-#include <dirent.h>
+#include <map>
+#include <vector>
 #include "progress_bar.hpp"
+#include "stats.hpp"
+#include "bit_writer.hpp"
+#include "input_file.hpp"
+#include "histogram.hpp"
+#include "block_format.hpp"
+#include "options.hpp"
+#include "stream_mode.hpp"
+#include "file_manifest.hpp"
 
 using namespace std;
 
 
-void write_from_uChar(unsigned char,unsigned char&,int,FILE*);
+void count_in_file(char*,input_file&,long int*);
 
-int this_is_not_a_folder(char*);
-long int size_of_the_file(char*);
-void count_in_folder(string,long int*,long int&,long int&);
-
-void write_file_count(int,unsigned char&,int,FILE*);
-void write_file_size(long int,unsigned char&,int,FILE*);
-void write_file_name(char*,string*,unsigned char&,int&,FILE*);
-void write_the_file_content(FILE*,long int,string*,unsigned char&,int&,FILE*);
-void write_the_folder(string,string*,unsigned char&,int&,FILE*);
+void write_file_count(int,bit_writer&);
+void write_file_size(long int,bit_writer&);
+void write_file_name(char*,code_table&,bit_writer&);
+void write_the_file_content(char*,input_file&,code_table&,bit_writer&);
 
 
 
@@ -34,9 +38,10 @@ https://en.wikipedia.org/wiki/Huffman_coding#Basic_technique
 
 1-Size information
 2-Counting usage frequency of unique bytes and unique byte count
-3-Creating the base of the translation array
-4-Creating the translation tree inside the translation array by weight distribution
-5-adding strings from top to bottom to create translated versions of unique bytes
+3-Sorting the used bytes by their frequencies
+4-Creating the translation tree inside a flat pool of nodes by weight distribution
+5-adding bits from top to bottom to create translated versions of unique bytes
+6-limiting the length of the translated versions (only if the tree is deeper than the limit)
 
 ---------PART 2-CREATION OF COMPRESSED FILE-----------
     Compressed File's structure had been documented below
@@ -61,21 +66,31 @@ fourth (2 bytes)**          ->  file_count (inside the current folder)
 *whenever we see a new folder we will write seventh then start writing from fourth to eighth
 **groups from fifth to eighth will be written as much as file count in that folder
     (this is argument_count-1(argc-1) for the main folder)
+The files and folders are scanned once into a list in this order (see file_manifest.hpp), both parts walk that list
 
 */
 
 progress PROGRESS;
-
-struct ersel{   //this structure will be used to create the translation tree
-    ersel *left,*right;
-    long int number;
-    unsigned char character;
-    string bit;
+run_stats STATS;
+
+struct sample_cache{    // this structure is used by the single pass mode (--single-pass)
+    // Instead of reading every input twice, only the beginning of each file is read while counting frequencies.
+    // Those bytes are kept here and encoded from memory later, and the encoding pass continues reading
+    // the file from where its sample ended. Frequencies of the bytes that were not sampled are estimated.
+    bool enabled=false;
+    long int budget=16<<20;         // bytes that can still be sampled
+    long int per_file=4<<20;        // at most this many bytes are sampled from a single file
+    long int sampled=0,skipped=0;   // file bytes that were sampled and that were not
+    long int number[256]={0};       // usage frequency of bytes inside the samples
+    map<string,vector<unsigned char>> prefix;
 };
 
-bool erselcompare0(ersel a,ersel b){
-    return a.number<b.number;
-}
+sample_cache SAMPLE;
+
+int ARCHIVE_VERSION=1;      // 2 when --blocks is given, see block_format.hpp
+int MAX_CODE_LENGTH=default_max_code_length;
+bool INTERLEAVED=false;     // --interleave: version 2 blocks with 4 streams
+central_directory DIRECTORY;    // version 2: every file and folder in the order they are written
 
 
 
@@ -83,10 +98,35 @@ int main(int argc,char *argv[]){
     long int number[256];
     long int total_bits=0;
     int letter_count=0;
+    archive_options options;
+    if(!parse_options(argc,argv,options)){
+        return 1;
+    }
+    ARCHIVE_VERSION=options.version;
+    MAX_CODE_LENGTH=options.max_code_length;
+    INTERLEAVED=options.interleaved;
+    SAMPLE.enabled=options.single_pass;
+    if(options.progress.size())PROGRESS.set_mode(options.progress);
+    if(ARCHIVE_VERSION==2){
+        SAMPLE.enabled=false;   // block tables are made from the blocks themselves, every file is read once anyway
+    }
+    if(options.stream){
+        if(argc>2){
+            cerr<<"Stream mode (-c) takes one file"<<endl;
+            return 1;
+        }
+        return compress_stream(argc==2?argv[1]:"-",MAX_CODE_LENGTH,INTERLEAVED);
+    }
     if(argc==1){
-        cout<<"Missing file name"<<endl<<"try './archive {{file_name}}'"<<endl;
+        cout<<"Missing file name"<<endl<<"try './archive {{file_name}}'"<<endl
+            <<"or './archive --single-pass {{file_name}}' to read every file only once"<<endl
+            <<"or './archive --blocks {{file_name}}' to translate files block by block with their own tables"<<endl
+            <<"or './archive -c - < {{file_name}} > {{compressed_file}}' to compress a stream"<<endl
+            <<"('--max-code-length {{bits}}' limits the length of codes, it is "<<default_max_code_length<<" by default)"<<endl
+            <<"other options: -o {{compressed_file}}, --no-confirm, --password-file {{file}}, --level {{1-9}} (see options.hpp)"<<endl;
         return 0;
     }
+    STATS.begin("archive",options.stats);
     for(long int *i=number;i<number+256;i++){                       
         *i=0;
     }
@@ -94,19 +134,25 @@ int main(int argc,char *argv[]){
     string scompressed;
     FILE *original_fp,*compressed_fp;
 
-    for(int i=1;i<argc;i++){                    //checking for wrong input
-        if(this_is_not_a_folder(argv[i])){
-            original_fp=fopen(argv[i],"rb");
+    vector<manifest_entry> manifest;
+    build_manifest(argc,argv,manifest);
+    for(manifest_entry &entry:manifest){        //checking for wrong input
+        if(entry.name==0&&!entry.folder){
+            original_fp=fopen(&entry.path[0],"rb");
             if(!original_fp){
-                cout<<argv[i]<<" file does not exist"<<endl<<"Process has been terminated"<<endl;
-                return 0;
+                cout<<entry.path<<" file does not exist"<<endl<<"Process has been terminated"<<endl;
+                return 1;
             }
             fclose(original_fp);
         }
     }
+    STATS.phase("scan",0);
 
     scompressed=argv[1];
     scompressed+=".compressed";
+    if(options.output.size()){
+        scompressed=options.output;
+    }
 
 
     //------------------1 and 2--------------------
@@ -115,33 +161,46 @@ int main(int argc,char *argv[]){
             // after this code block, program checks the 'number' array
             //and writes the number of unique bytes count to 'letter_count' variable
 
-    unsigned char *x_p,x;                  //these are temp variables to take input from the file
-    x_p=&x;
     long int total_size=0,size;
-    total_bits+=16+9*(argc-1);
-    for(int current_file=1;current_file<argc;current_file++){
+    total_bits+=16;     //for the file_count of the main folder
+    for(manifest_entry &entry:manifest){
+        total_bits+=9;
 
-        for(char *c=argv[current_file];*c;c++){        //counting usage frequency of unique bytes on the file name (or folder name)
+        for(char *c=&entry.path[entry.name];*c;c++){        //counting usage frequency of unique bytes on the file name (or folder name)
             number[(unsigned char)(*c)]++;
         }
 
-        if(this_is_not_a_folder(argv[current_file])){
-            total_size+=size=size_of_the_file(argv[current_file]);
+        if(entry.folder){
+            total_size+=4096;
+            total_bits+=16; //for file_count
+        }
+        else{
+            total_size+=entry.size;
             total_bits+=64;
-
-            original_fp=fopen(argv[current_file],"rb");
-            fread(x_p,1,1,original_fp);
-            for(long int j=0;j<size;j++){    //counting usage frequency of unique bytes inside the file
-                number[x]++;
-                fread(x_p,1,1,original_fp);
+            if(ARCHIVE_VERSION!=2){     // version 2 archives count their blocks while they are written
+                input_file input;
+                if(!input.open(&entry.path[0])){
+                    cout<<entry.path<<" can not be read"<<endl<<"Process has been terminated"<<endl;
+                    return 1;
+                }
+                count_in_file(&entry.path[0],input,number);    //counting usage frequency of unique bytes inside the file
             }
-            fclose(original_fp);
+        }
+    }
 
+    if(SAMPLE.enabled){
+        // when the samples hold every byte of the files, their frequencies are exact and the result is the same as the two pass mode
+        // otherwise they are scaled up to the total file size and every byte gets at least 1 so that bytes
+        // that do not appear in the samples can still be translated
+        double scale=SAMPLE.sampled?(double)(SAMPLE.sampled+SAMPLE.skipped)/SAMPLE.sampled:0;
+        for(int i=0;i<256;i++){
+            if(SAMPLE.skipped){
+                number[i]+=(long int)(SAMPLE.number[i]*scale)+1;
+            }
+            else{
+                number[i]+=SAMPLE.number[i];
+            }
         }
-        else{
-            string temp=argv[current_file];
-            count_in_folder(temp,number,total_size,total_bits);
-        }        
     }
 
 	for(long int *i=number;i<number+256;i++){                 
@@ -149,101 +208,22 @@ int main(int argc,char *argv[]){
 			letter_count++;
 			}
     }
+    STATS.phase("count",ARCHIVE_VERSION==2?0:SAMPLE.enabled?SAMPLE.sampled:total_size);
     //---------------------------------------------
 
 
 
-    //--------------------3------------------------
-        // creating the base of translation array(and then sorting them by ascending frequencies
-        // this array of type 'ersel' will not be used after calculating transformed versions of every unique byte
-        // instead its info will be written in a new string array called str_arr 
-    ersel array[letter_count*2-1];
-    ersel *e=array;
-    for(long int *i=number;i<number+256;i++){                         
-        	if(*i){
-                e->right=NULL;
-                e->left=NULL;
-                e->number=*i;
-                e->character=i-number;
-                e++;
-            }
-    }
-    sort(array,array+letter_count,erselcompare0);
-    //---------------------------------------------
-    
-                   
-    
-    //-------------------4-------------------------
-        // min1 and min2 represents nodes that has minimum weights
-        // isleaf is the pointer that traverses through leafs and
-        // notleaf is the pointer that traverses through nodes that are not leafs
-    ersel *min1=array,*min2=array+1,*current=array+letter_count,*notleaf=array+letter_count,*isleaf=array+2;            
-    for(int i=0;i<letter_count-1;i++){                           
-        current->number=min1->number+min2->number;
-        current->left=min1;
-        current->right=min2;
-        min1->bit="1";
-        min2->bit="0";     
-        current++;
-        
-        if(isleaf>=array+letter_count){
-            min1=notleaf;
-            notleaf++;
-        }
-        else{
-            if(isleaf->number<notleaf->number){
-                min1=isleaf;
-                isleaf++;
-            }
-            else{
-                min1=notleaf;
-                notleaf++;
-            }
-        }
-        
-        if(isleaf>=array+letter_count){
-            min2=notleaf;
-            notleaf++;
-        }
-        else if(notleaf>=current){
-            min2=isleaf;
-            isleaf++;
-        }
-        else{
-            if(isleaf->number<notleaf->number){
-                min2=isleaf;
-                isleaf++;
-            }
-            else{
-                min2=notleaf;
-                notleaf++;
-            }
-        }
-        
-    }
-        // At every cycle, 2 of the least weighted nodes will be chosen to
-        // create a new node that has weight equal to sum of their weights combined.
-            // After we are done with these nodes they will become childrens of created nodes
-            // and they will be passed so that they wont be used in this process again.
-    //---------------------------------------------
-
-
-    
-    //-------------------5-------------------------
-    for(e=array+letter_count*2-2;e>array-1;e--){
-        if(e->left){
-            e->left->bit=e->bit+e->left->bit;
-        }
-        if(e->right){
-            e->right->bit=e->bit+e->right->bit;
-        }
-        
-    }
-        // In this block we are adding the bytes from root to leafs
-        // and after this is done every leaf will have a transformation string that corresponds to it
-            // Note: It is actually a very neat process. Using 4th and 5th code blocks, we are making sure that
+    //-----------------3 to 6----------------------
+        // the translation tree is built inside a flat pool of integers (see huffman_tree_codes in block_format.hpp):
+        // the used bytes are sorted by ascending frequencies (3), the two lightest leaves or nodes are merged
+        // until only the root is left (4), and walking from the root to the leaves gives every byte its code (5),
+        // the first of the two merged ones adds a 1 and the second one a 0 to the codes below it.
+        // If the tree is deeper than MAX_CODE_LENGTH, canonical codes that are not longer than that are used instead (6)
+            // Note: It is actually a very neat process. Merging the lightest ones first makes sure that
             // the most used character is using least number of bits.
-                // Specific number of bits we re going to use for that character is determined by weight distribution
+    huffman_tree tree;
+    huffman_tree_codes(number,tree,MAX_CODE_LENGTH);
+    STATS.phase("tree",0);
     //---------------------------------------------
 
 
@@ -258,45 +238,65 @@ int main(int argc,char *argv[]){
 
 
     compressed_fp=fopen(&scompressed[0],"wb");
-    int current_bit_count=0;
-    unsigned char current_byte;
+    if(!compressed_fp){
+        cout<<scompressed<<" can not be created"<<endl<<"Process has been terminated"<<endl;
+        return 1;
+    }
+    bit_writer writer(compressed_fp);
     //--------------writes first--------------
-    fwrite(&letter_count,1,1,compressed_fp);
-    total_bits+=8;
+    if(ARCHIVE_VERSION==2){
+        write_archive_magic(writer);
+        total_bits+=40;
+    }
+    else{
+        writer.write_byte(letter_count);
+        total_bits+=8;
+    }
     //----------------------------------------
 
 
 
     //--------------writes second-------------
     {
-        cout<<"If you want a password write any number other then 0"<<endl
-            <<"If you do not, write 0"<<endl;
-        int check_password;
-        cin>>check_password;
+        int check_password=options.password.size();
+        string password=options.password;
+        if(options.ask_password){       // --no-confirm and --password-file skip the questions
+            cout<<"If you want a password write any number other then 0"<<endl
+                <<"If you do not, write 0"<<endl;
+            cin>>check_password;
+            if(check_password){
+                cout<<"Enter your password (Do not use whitespaces): ";
+                cin>>password;
+            }
+        }
         if(check_password){
-            string password;
-            cout<<"Enter your password (Do not use whitespaces): ";
-            cin>>password;
             int password_length=password.length();
             if(password_length==0){
                 cout<<"You did not enter a password"<<endl<<"Process has been terminated"<<endl;
                 fclose(compressed_fp);
                 remove(&scompressed[0]);
-                return 0;
+                return 1;
             }
             if(password_length>100){
                 cout<<"Password cannot contain more then 100 characters"<<endl<<"Process has been terminated"<<endl;
                 fclose(compressed_fp);
                 remove(&scompressed[0]);
-                return 0;
+                return 1;
+            }
+            if(password.find_first_of(" \t")!=string::npos){    // possible with --password-file, extract could not ask for it
+                cout<<"Password cannot contain whitespaces"<<endl<<"Process has been terminated"<<endl;
+                fclose(compressed_fp);
+                remove(&scompressed[0]);
+                return 1;
+            }
+            writer.write_byte(password_length);
+            for(int i=0;i<password_length;i++){
+                writer.write_byte(password[i]);
             }
-            unsigned char password_length_unsigned=password_length;
-            fwrite(&password_length_unsigned,1,1,compressed_fp);
-            fwrite(&password[0],1,password_length,compressed_fp);
             total_bits+=8+8*password_length;
         }
         else{
-            fwrite(&check_password,1,1,compressed_fp);
+            writer.write_byte(0);
             total_bits+=8;
         }
     }
@@ -314,112 +314,121 @@ int main(int argc,char *argv[]){
 
 
     //------------writes third---------------
-    char *str_pointer;
     unsigned char len,current_character;
-    string str_arr[256];
-    for(e=array;e<array+letter_count;e++){
-        str_arr[(e->character)]=e->bit;     //we are putting the transformation string to str_arr array to make the compression process more time efficient
-        len=e->bit.length();
-        current_character=e->character;
-
-        write_from_uChar(current_character,current_byte,current_bit_count,compressed_fp);
-        write_from_uChar(len,current_byte,current_bit_count,compressed_fp);
-        total_bits+=len+16;
-        // above lines will write the byte and the number of bits
-        // we re going to need to represent this specific byte's transformated version
-        // after here we are going to write the transformed version of the number bit by bit.
+    code_table table;
+    if(ARCHIVE_VERSION==2){
+        // version 2 archives use canonical codes, only their lengths are written
+        int length[256];
+        huffman_code_lengths(number,length,MAX_CODE_LENGTH);
+        canonical_codes(length,table);
+        write_code_lengths(length,writer);
+    }
+    else{
+        table=tree.table;       // the transformations as integer codes, that makes the compression process more time efficient
+        for(int i=0;i<tree.n;i++){
+            current_character=tree.symbols[i];
+            len=table.length[current_character];
+
+            writer.write_byte(current_character);
+            writer.write_byte(len);
+            total_bits+=len+16;
+            // above lines will write the byte and the number of bits
+            // we re going to need to represent this specific byte's transformated version
+            // after here we are going to write the transformed version of the number.
         
-        str_pointer=&e->bit[0];
-        while(*str_pointer){
-            if(current_bit_count==8){
-                fwrite(&current_byte,1,1,compressed_fp);
-                current_bit_count=0;
-            }
-            switch(*str_pointer){
-                case '1':current_byte<<=1;current_byte|=1;current_bit_count++;break;
-                case '0':current_byte<<=1;current_bit_count++;break;
-                default:cout<<"An error has occurred"<<endl<<"Compression process aborted"<<endl;
-                fclose(compressed_fp);
-                remove(&scompressed[0]);
-                return 1;
-            }
-           str_pointer++;
-        }
+            writer.write_symbol(table,current_character);
         
-         total_bits+=len*(e->number);
+             total_bits+=len*number[current_character];
+        }
     }
     if(total_bits%8){
         total_bits=(total_bits/8+1)*8;        
         // from this point on total bits doesnt represent total bits
         // instead it represents 8*number_of_bytes we are gonna use on our compressed file
     }
-    // Above loop writes the translation script into compressed file and the str_arr array
+    // Above loop writes the translation script into compressed file and the code table
     //----------------------------------------
 
 
     cout<<"The size of the sum of ORIGINAL files is: "<<total_size<<" bytes"<<endl;
-    cout<<"The size of the COMPRESSED file will be: "<<total_bits/8<<" bytes"<<endl;
-    cout<<"Compressed file's size will be [%"<<100*((float)total_bits/8/total_size)<<"] of the original file"<<endl;
-    if(total_bits/8>total_size){
-        cout<<endl<<"COMPRESSED FILE'S SIZE WILL BE HIGHER THAN THE SUM OF ORIGINALS"<<endl<<endl;
-    }
-    cout<<"If you wish to abort this process write 0 and press enter"<<endl
-        <<"If you want to continue write any other number and press enter"<<endl;
-    int check;
-    cin>>check;
+    if(ARCHIVE_VERSION==2){
+        cout<<"The size of the COMPRESSED file will be known after the blocks are translated"<<endl;
+    }
+    else{
+        cout<<"The size of the COMPRESSED file will be: "<<total_bits/8<<" bytes";
+        if(SAMPLE.skipped){
+            cout<<" (estimated from a "<<SAMPLE.sampled<<" byte sample)";
+        }
+        cout<<endl;
+        cout<<"Compressed file's size will be [%"<<100*((float)total_bits/8/total_size)<<"] of the original file"<<endl;
+        if(total_bits/8>total_size){
+            cout<<endl<<"COMPRESSED FILE'S SIZE WILL BE HIGHER THAN THE SUM OF ORIGINALS"<<endl<<endl;
+        }
+    }
+    STATS.phase("header",0);
+    int check=1;
+    if(options.confirm){
+        cout<<"If you wish to abort this process write 0 and press enter"<<endl
+            <<"If you want to continue write any other number and press enter"<<endl;
+        cin>>check;
+    }
     if(!check){
         cout<<endl<<"Process has been aborted"<<endl;
         fclose(compressed_fp);
         remove(&scompressed[0]);
         return 0;
     }
+    STATS.phase("confirm",0);
 
 
 
-    PROGRESS.MAX=(array+letter_count*2-2)->number;      //setting progress bar
+    PROGRESS.MAX=tree.total;      //setting progress bar
+    if(ARCHIVE_VERSION==2){
+        PROGRESS.MAX=total_size>0?total_size:1;     // file contents are not inside the name table's weights
+    }
 
     //-------------writes fourth---------------
-    write_file_count(argc-1,current_byte,current_bit_count,compressed_fp);
+    write_file_count(argc-1,writer);
     //---------------------------------------
 
-    for(int current_file=1;current_file<argc;current_file++){
-        
-        if(this_is_not_a_folder(argv[current_file])){   //if current is a file and not a folder
-            original_fp=fopen(argv[current_file],"rb");
-            fseek(original_fp,0,SEEK_END);
-            size=ftell(original_fp);
-            rewind(original_fp);
+    for(manifest_entry &entry:manifest){
+        char *name=&entry.path[entry.name];
+        if(!entry.folder){   //if current is a file and not a folder
+            input_file input;
+            if(!input.open(&entry.path[0])){
+                cout<<entry.path<<" can not be read"<<endl<<"Process has been terminated"<<endl;
+                fclose(compressed_fp);
+                remove(&scompressed[0]);
+                return 1;
+            }
+            size=input.size;
 
             //-------------writes fifth--------------
-            if(current_bit_count==8){
-                fwrite(&current_byte,1,1,compressed_fp);
-                current_bit_count=0;
+            if(ARCHIVE_VERSION==2){
+                writer.align();
+                writer.mark();      // for the central directory
+                DIRECTORY.push_back({entry.path,true,size,0,0});
             }
-            current_byte<<=1;
-            current_byte|=1;
-            current_bit_count++;
+            writer.write(1,1);
             //---------------------------------------
 
-            write_file_size(size,current_byte,current_bit_count,compressed_fp);             //writes sixth
-            write_file_name(argv[current_file],str_arr,current_byte,current_bit_count,compressed_fp);   //writes seventh
-            write_the_file_content(original_fp,size,str_arr,current_byte,current_bit_count,compressed_fp);      //writes eighth
-            fclose(original_fp);
+            write_file_size(size,writer);             //writes sixth
+            write_file_name(name,table,writer);       //writes seventh
+            write_the_file_content(&entry.path[0],input,table,writer);      //writes eighth
         }
         else{   //if current is a folder instead
 
             //-------------writes fifth--------------
-            if(current_bit_count==8){
-                fwrite(&current_byte,1,1,compressed_fp);
-                current_bit_count=0;
+            if(ARCHIVE_VERSION==2){
+                writer.align();
+                writer.mark();
+                DIRECTORY.push_back({entry.path,false,0,0,0});
             }
-            current_byte<<=1;
-            current_bit_count++;
+            writer.write(0,1);
             //---------------------------------------
 
-            write_file_name(argv[current_file],str_arr,current_byte,current_bit_count,compressed_fp);   //writes seventh
-
-            string folder_name=argv[current_file];
-            write_the_folder(folder_name,str_arr,current_byte,current_bit_count,compressed_fp);
+            write_file_name(name,table,writer);      //writes seventh
+            write_file_count(entry.entries,writer);  //writes fourth, the entries inside it come next in the list
         }
     }
 
@@ -427,52 +436,40 @@ int main(int argc,char *argv[]){
 
 
 
-    if(current_bit_count==8){      // here we are writing the last byte of the file
-        fwrite(&current_byte,1,1,compressed_fp);
+    STATS.phase("content",total_size);
+    if(ARCHIVE_VERSION==2){
+        write_central_directory(writer,DIRECTORY);
     }
-    else{
-        current_byte<<=8-current_bit_count;
-        fwrite(&current_byte,1,1,compressed_fp);
-    }
-
+    writer.finish();      // here we are writing the last byte of the file
     fclose(compressed_fp);
-    system("clear");
+    STATS.finish("finish",0,total_size);
+    PROGRESS.finish();
     cout<<endl<<"Created compressed file: "<<scompressed<<endl;
+    if(ARCHIVE_VERSION==2){
+        cout<<"Compressed file's size is "<<writer.flushed<<" bytes";
+        if(total_size)cout<<" [%"<<100*((float)writer.flushed/total_size)<<"] of the original files";
+        cout<<endl;
+    }
     cout<<"Compression is complete"<<endl;
     
 }
 
 
 
-//below function is used for writing the uChar to compressed file
-    //It does not write it directly as one byte instead it mixes uChar and current byte, writes 8 bits of it 
-    //and puts the rest to curent byte for later use
-void write_from_uChar(unsigned char uChar,unsigned char &current_byte,int current_bit_count,FILE *fp_write){
-    current_byte<<=8-current_bit_count;
-    current_byte|=(uChar>>current_bit_count);
-    fwrite(&current_byte,1,1,fp_write);
-    current_byte=uChar;   
-}
-
-
-
 //below function is writing number of files we re going to translate inside current folder to compressed file's 2 bytes
     //It is done like this to make sure that it can work on little, big or middle-endian systems
-void write_file_count(int file_count,unsigned char &current_byte,int current_bit_count,FILE *compressed_fp){
-    unsigned char temp=file_count%256;
-    write_from_uChar(temp,current_byte,current_bit_count,compressed_fp);
-    temp=file_count/256;
-    write_from_uChar(temp,current_byte,current_bit_count,compressed_fp);
+void write_file_count(int file_count,bit_writer &writer){
+    writer.write_byte(file_count%256);
+    writer.write_byte(file_count/256);
 }
 
 
 
 //This function is writing byte count of current input file to compressed file using 8 bytes
     //It is done like this to make sure that it can work on little, big or middle-endian systems
-void write_file_size(long int size,unsigned char &current_byte,int current_bit_count,FILE *compressed_fp){
-    PROGRESS.next(size);        //updating progress bar
+void write_file_size(long int size,bit_writer &writer){
     for(int i=0;i<8;i++){
-        write_from_uChar(size%256,current_byte,current_bit_count,compressed_fp);
+        writer.write_byte(size%256);
         size/=256;
     }
 }
@@ -480,192 +477,67 @@ void write_file_size(long int size,unsigned char &current_byte,int current_bit_c
 
 
 // This function writes bytes that are translated from current input file's name to the compressed file.
-void write_file_name(char *file_name,string *str_arr,unsigned char &current_byte,int &current_bit_count,FILE *compressed_fp){
-    write_from_uChar(strlen(file_name),current_byte,current_bit_count,compressed_fp);
-    char *str_pointer;
+void write_file_name(char *file_name,code_table &table,bit_writer &writer){
+    writer.write_byte(strlen(file_name));
     for(char *c=file_name;*c;c++){
-        str_pointer=&str_arr[(unsigned char)(*c)][0];
-        while(*str_pointer){
-            if(current_bit_count==8){
-                fwrite(&current_byte,1,1,compressed_fp);
-                current_bit_count=0;
-            }
-            switch(*str_pointer){
-                case '1':current_byte<<=1;current_byte|=1;current_bit_count++;break;
-                case '0':current_byte<<=1;current_bit_count++;break;
-                default:cout<<"An error has occurred"<<endl<<"Process has been aborted";
-                exit(2);
-            }
-            str_pointer++;
-        }
+        writer.write_symbol(table,(unsigned char)(*c));
     }
 }
 
 
 
 // Below function translates and writes bytes from current input file to the compressed file.
-void write_the_file_content(FILE *original_fp,long int size,string *str_arr,unsigned char &current_byte,int &current_bit_count,FILE *compressed_fp){
-    unsigned char *x_p,x;
-    x_p=&x;
-    char *str_pointer;
-    fread(x_p,1,1,original_fp);
-    for(long int i=0;i<size;i++){
-        str_pointer=&str_arr[x][0];
-        while(*str_pointer){
-            if(current_bit_count==8){
-                fwrite(&current_byte,1,1,compressed_fp);
-                current_bit_count=0;
-            }
-            switch(*str_pointer){
-                case '1':current_byte<<=1;current_byte|=1;current_bit_count++;break;
-                case '0':current_byte<<=1;current_bit_count++;break;
-                default:cout<<"An error has occurred"<<endl<<"Process has been aborted";
-                exit(2);
+    // in single pass mode the sampled beginning of the file is taken from memory
+    // in version 2 archives the file is written block by block with their own tables instead
+    // (and its checksum goes to the central directory)
+void write_the_file_content(char *path,input_file &input,code_table &table,bit_writer &writer){
+    if(ARCHIVE_VERSION==2){
+        DIRECTORY.back().checksum=write_file_blocks(input,default_block_size,writer,MAX_CODE_LENGTH,INTERLEAVED,
+                                                    [](long int n){PROGRESS.add(n);});
+        return;
+    }
+    if(SAMPLE.enabled){
+        map<string,vector<unsigned char>>::iterator sample=SAMPLE.prefix.find(path);
+        if(sample!=SAMPLE.prefix.end()){
+            for(unsigned char x:sample->second){
+                writer.write_symbol(table,x);
             }
-            str_pointer++;
+            input.seek(sample->second.size());
+            PROGRESS.add(sample->second.size());
+            SAMPLE.prefix.erase(sample);
         }
-        fread(x_p,1,1,original_fp);
-    }
-}
-
-int this_is_not_a_folder(char *path){
-    DIR *temp=opendir(path);
-    if(temp){
-        closedir(temp);
-        return 0;
     }
-    return 1;
-}
-
-long int size_of_the_file(char *path){
-    long int size;
-    FILE *fp=fopen(path,"rb");
-    fseek(fp,0,SEEK_END);
-    size=ftell(fp);
-    fclose(fp);
-    return size;
-}
-
-
-
-// This function counts usage frequency of bytes inside a folder
-    // only give folder path as input
-void count_in_folder(string path,long int *number,long int &total_size,long int &total_bits){
-    FILE *original_fp;
-    path+='/';
-    DIR *dir=opendir(&path[0]),*next_dir;
-    string next_path;
-    total_size+=4096;
-    total_bits+=16; //for file_count
-    struct dirent *current;
-    while((current=readdir(dir))){
-        if(current->d_name[0]=='.'){
-            if(current->d_name[1]==0)continue;
-            if(current->d_name[1]=='.'&&current->d_name[2]==0)continue;
-        }
-        total_bits+=9;
-
-        for(char *c=current->d_name;*c;c++){        //counting usage frequency of bytes on the file name (or folder name)
-            number[(unsigned char)(*c)]++;
-        }
-
-        next_path=path+current->d_name;
-
-        if((next_dir=opendir(&next_path[0]))){
-            closedir(next_dir);
-            count_in_folder(next_path,number,total_size,total_bits);
-        }
-        else{
-            long int size;
-            unsigned char *x_p,x;
-            x_p=&x;
-            total_size+=size=size_of_the_file(&next_path[0]);
-            total_bits+=64;
-
-            //--------------------2------------------------
-            original_fp=fopen(&next_path[0],"rb");
-
-            fread(x_p,1,1,original_fp);
-            for(long int j=0;j<size;j++){    //counting usage frequency of bytes inside the file
-                number[x]++;
-                fread(x_p,1,1,original_fp);
-            }
-            fclose(original_fp);
+    const unsigned char *data;
+    long int n;
+    while((n=input.next(data))){
+        for(const unsigned char *end=data+n;data<end;data++){
+            writer.write_symbol(table,*data);
         }
+        PROGRESS.add(n);        //updating progress bar
     }
-    closedir(dir);
 }
 
-
-
-
-
-
-
-void write_the_folder(string path,string *str_arr,unsigned char &current_byte,int &current_bit_count,FILE *compressed_fp){
-    FILE *original_fp;
-    path+='/';
-    DIR *dir=opendir(&path[0]),*next_dir;
-    string next_path;
-    struct dirent *current;
-    int file_count=0;
-    long int size;
-    while((current=readdir(dir))){
-        if(current->d_name[0]=='.'){
-            if(current->d_name[1]==0)continue;
-            if(current->d_name[1]=='.'&&current->d_name[2]==0)continue;
+// This function counts usage frequency of bytes inside an input file
+    // the file is given to the histogram kernel in large pieces
+    // in single pass mode only the beginning of the file is read, counted and kept for the encoding pass
+    // version 2 archives don't need it, their blocks are counted while they are written
+void count_in_file(char *path,input_file &input,long int *number){
+    const unsigned char *data;
+    long int n;
+    if(ARCHIVE_VERSION==2)return;
+    if(SAMPLE.enabled){
+        long int limit=input.size<SAMPLE.per_file?input.size:SAMPLE.per_file;
+        if(limit>SAMPLE.budget)limit=SAMPLE.budget;
+        if(limit>0&&(n=input.next(data,limit))){
+            count_bytes(data,n,SAMPLE.number);
+            SAMPLE.prefix[path].assign(data,data+n);
+            SAMPLE.budget-=n;
+            SAMPLE.sampled+=n;
         }
-        file_count++;
+        SAMPLE.skipped+=input.size-input.offset;
+        return;
     }
-    rewinddir(dir);
-    write_file_count(file_count,current_byte,current_bit_count,compressed_fp);  //writes fourth
-
-    while((current=readdir(dir))){  //if current is a file
-        if(current->d_name[0]=='.'){
-            if(current->d_name[1]==0)continue;
-            if(current->d_name[1]=='.'&&current->d_name[2]==0)continue;
-        }
-
-        next_path=path+current->d_name;
-        if(this_is_not_a_folder(&next_path[0])){
-
-            original_fp=fopen(&next_path[0],"rb");
-            fseek(original_fp,0,SEEK_END);
-            size=ftell(original_fp);
-            rewind(original_fp);
-
-            //-------------writes fifth--------------
-            if(current_bit_count==8){
-                fwrite(&current_byte,1,1,compressed_fp);
-                current_bit_count=0;
-            }
-            current_byte<<=1;
-            current_byte|=1;
-            current_bit_count++;
-            //---------------------------------------
-
-            write_file_size(size,current_byte,current_bit_count,compressed_fp);                     //writes sixth
-            write_file_name(current->d_name,str_arr,current_byte,current_bit_count,compressed_fp);                //writes seventh
-            write_the_file_content(original_fp,size,str_arr,current_byte,current_bit_count,compressed_fp);      //writes eighth
-            fclose(original_fp);
-        }
-        else{   // if current is a folder
-
-            //-------------writes fifth--------------
-            if(current_bit_count==8){
-                fwrite(&current_byte,1,1,compressed_fp);
-                current_bit_count=0;
-            }
-            current_byte<<=1;
-            current_bit_count++;
-            //---------------------------------------
-
-            write_file_name(current->d_name,str_arr,current_byte,current_bit_count,compressed_fp);   //writes seventh
-
-            write_the_folder(next_path,str_arr,current_byte,current_bit_count,compressed_fp);
-        }
+    while((n=input.next(data))){
+        count_bytes(data,n,number);
     }
-    closedir(dir);
-
-
-}
\ No newline at end of file
+}
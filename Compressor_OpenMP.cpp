@@ -4,93 +4,201 @@
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
-#include <dirent.h>
 #include <omp.h>
 #include <vector>
+#include <memory>
 #include "progress_bar.hpp"
+#include "stats.hpp"
+#include "bit_writer.hpp"
+#include "input_file.hpp"
+#include "histogram.hpp"
+#include "block_format.hpp"
+#include "options.hpp"
+#include "stream_mode.hpp"
+#include "file_manifest.hpp"
 
 using namespace std;
 
-void write_from_uChar(unsigned char, unsigned char &, int &, FILE *);
-void write_from_uChar(unsigned char, unsigned char &, int &, vector<unsigned char> &);
+void count_in_file(input_file &, long int *);
 
-int this_is_not_a_folder(char *);
-long int size_of_the_file(char *);
-void count_in_folder(string, long int *, long int &, long int &);
-
-void write_file_count(int, unsigned char &, int &, FILE *);
-void write_file_size(long int, unsigned char &, int &, vector<unsigned char> &);
-void write_file_name(char *, string *, unsigned char &, int &, vector<unsigned char> &);
-void write_the_file_content(FILE *, long int, string *, unsigned char &, int &, vector<unsigned char> &);
-void write_the_folder(string, string *, unsigned char &, int &, vector<unsigned char> &);
+void write_file_count(int, bit_writer &);
+void write_file_size(long int, bit_writer &);
+void write_file_name(char *, code_table &, bit_writer &);
 
 progress PROGRESS;
+run_stats STATS;
+
+int ARCHIVE_VERSION = 1; // 2 when --blocks is given, see block_format.hpp
+int MAX_CODE_LENGTH = default_max_code_length;
+bool INTERLEAVED = false; // --interleave: version 2 blocks with 4 streams
+central_directory DIRECTORY; // version 2: every file and folder in the order they are written
+
+// Bounded memory output
+  // The archive is written as a sequence of units in order. The main thread walks the inputs, writes the headers
+  // (fourth to seventh) into 'header' and cuts the content of every file into segments. A segment is encoded by an
+  // OpenMP task into one of a fixed ring of slots and another task appends that slot to the archive afterwards.
+  // Appending tasks depend on each other so they run in the order of the archive, and the encoding task of a slot
+  // depends on the appending task that used the slot before it, so only the slots ever hold compressed data
+  // and memory does not grow with the size of the inputs.
+  // Segments end in the middle of bytes (version 1), append() shifts every unit to where the previous one ended.
+  // In version 2 every segment's checksum is calculated with it and the appending tasks combine them in order.
+struct output_pipeline
+{
+  static const long int segment_size = 4 * default_block_size;
+  bit_writer &out;
+  code_table &table;
+  vector<bit_writer> slots;
+  vector<unsigned int> checksums; // of the segment inside every slot
+  bit_writer header;
+  long int units = 0;
+  int order = 0; // only used as a dependency, it keeps the appending tasks in order
+
+  output_pipeline(bit_writer &o, code_table &t, int ring) : out(o), table(t), slots(ring, bit_writer(NULL, segment_size + 1024)), checksums(ring), header(NULL, 1 << 12) {}
+
+  // the headers that were written since the last segment become a unit of their own
+  void submit_header()
+  {
+    if (!header.bit_count() && header.marks.empty())
+      return;
+    shared_ptr<bit_writer> unit = make_shared<bit_writer>((FILE *)NULL, 1 << 12);
+    swap(*unit, header);
+    bit_writer *target = &out;
+#pragma omp task firstprivate(unit, target) depend(inout : this->order)
+    target->append(*unit);
+  }
 
-struct ersel
-{ // this structure will be used to create the translation tree
-  ersel *left, *right;
-  long int number;
-  unsigned char character;
-  string bit;
-};
+  // every segment's task keeps its file open, so the main thread waits for the submitted units
+  // after twice as many segments as there are slots (trees with many small files ran out of file descriptors)
+  void submit_segment(shared_ptr<input_file> input, long int offset, long int n, directory_entry *entry)
+  {
+    submit_header();
+    if (units && units % (2 * slots.size()) == 0)
+    {
+#pragma omp taskwait
+    }
+    int index = units++ % slots.size();
+    bit_writer *slot = &slots[index];
+    unsigned int *checksum = &checksums[index];
+    code_table *codes = &table;
+    bit_writer *target = &out;
+#pragma omp task firstprivate(input, offset, n, slot, checksum, codes) depend(inout : slot[0])
+    {
+      vector<unsigned char> buffer;
+      const unsigned char *data = input->piece(offset, n, buffer);
+      slot->clear();
+      if (ARCHIVE_VERSION == 2)
+      {
+        *checksum = crc32_update(0, data, n);
+        for (long int i = 0; i < n; i += default_block_size)
+        {
+          encode_block(data + i, min(default_block_size, n - i), *slot, MAX_CODE_LENGTH, INTERLEAVED);
+          PROGRESS.add(min(default_block_size, n - i)); // updating progress bar
+        }
+      }
+      else
+      {
+        for (const unsigned char *end = data + n; data < end; data++)
+          slot->write_symbol(*codes, *data);
+        PROGRESS.add(n);
+      }
+    }
+#pragma omp task firstprivate(slot, checksum, n, entry, target) depend(inout : slot[0]) depend(inout : this->order)
+    {
+      if (entry)
+        entry->checksum = crc32_combine(entry->checksum, *checksum, n);
+      target->append(*slot);
+    }
+  }
 
-bool erselcompare0(ersel a, ersel b)
-{
-  return a.number < b.number;
-}
+  // writes eighth of a file (entry is its place in the central directory, NULL in version 1)
+  void write_content(shared_ptr<input_file> input, directory_entry *entry)
+  {
+    if (ARCHIVE_VERSION == 2)
+      header.align();
+    for (long int offset = 0; offset < input->size; offset += segment_size)
+      submit_segment(input, offset, min(segment_size, input->size - offset), entry);
+  }
 
-// Function to assign codes to the Huffman tree
-void assign_codes(ersel *node, const string &code)
-{
-  if (!node)
-    return;
-  node->bit = code;
-  assign_codes(node->left, code + "1");
-  assign_codes(node->right, code + "0");
-}
+  // waits for every unit to be appended
+  void finish()
+  {
+    submit_header();
+#pragma omp taskwait
+  }
+};
 
 int main(int argc, char *argv[])
 {
   long int number[256] = {0};
   long int total_bits = 0;
   int letter_count = 0;
+  archive_options options;
+  if (!parse_options(argc, argv, options))
+    return 1;
+  ARCHIVE_VERSION = options.version;
+  MAX_CODE_LENGTH = options.max_code_length;
+  INTERLEAVED = options.interleaved;
+  if (options.progress.size())
+    PROGRESS.set_mode(options.progress);
+  if (options.threads)
+    omp_set_num_threads(options.threads);
+  if (options.stream)
+  {
+    if (argc > 2)
+    {
+      cerr << "Stream mode (-c) takes one file" << endl;
+      return 1;
+    }
+    return compress_stream(argc == 2 ? argv[1] : "-", MAX_CODE_LENGTH, INTERLEAVED);
+  }
   if (argc == 1)
   {
     cout << "Missing file name" << endl
-         << "try './archive {{file_name}}'" << endl;
+         << "try './archive {{file_name}}'" << endl
+         << "or './archive --blocks {{file_name}}' to translate files block by block with their own tables" << endl
+         << "('--max-code-length {{bits}}' limits the length of codes, it is " << default_max_code_length << " by default)" << endl
+         << "other options: -o {{compressed_file}}, --no-confirm, --password-file {{file}}, -j {{threads}}, --level {{1-9}} (see options.hpp)" << endl;
     return 0;
   }
+  STATS.begin("modified_archive", options.stats);
 
   string scompressed;
   FILE *original_fp, *compressed_fp;
 
+  // Scanning every file and folder once, in parallel (see file_manifest.hpp)
+  vector<manifest_entry> manifest;
+  build_manifest(argc, argv, manifest);
+
   // Check for wrong input
-  for (int i = 1; i < argc; i++)
+  for (manifest_entry &entry : manifest)
   {
-    if (this_is_not_a_folder(argv[i]))
+    if (entry.name == 0 && !entry.folder)
     {
-      original_fp = fopen(argv[i], "rb");
+      original_fp = fopen(&entry.path[0], "rb");
       if (!original_fp)
       {
-        cout << argv[i] << " file does not exist" << endl
+        cout << entry.path << " file does not exist" << endl
              << "Process has been terminated" << endl;
-        return 0;
+        return 1;
       }
       fclose(original_fp);
     }
   }
+  STATS.phase("scan", 0);
 
   scompressed = argv[1];
   scompressed += ".compressed";
+  if (options.output.size())
+    scompressed = options.output;
 
-  unsigned char x;
-  long int total_size = 0, size;
-  total_bits += 16 + 9 * (argc - 1);
+  long int total_size = 0;
+  total_bits += 16; // for the file_count of the main folder
 
   // Parallel region for counting byte frequencies
   long int total_number[256] = {0};
   long int global_total_size = 0;
   long int global_total_bits = 0;
+  string unreadable; // a file that could not be opened
 
 #pragma omp parallel
   {
@@ -98,33 +206,38 @@ int main(int argc, char *argv[])
     long int local_total_size = 0;
     long int local_total_bits = 0;
 
+    // every file of the manifest is counted on its own, so a single large folder uses every thread too
 #pragma omp for schedule(dynamic) nowait
-    for (int current_file = 1; current_file < argc; current_file++)
+    for (long int i = 0; i < (long int)manifest.size(); i++)
     {
+      manifest_entry &entry = manifest[i];
+      local_total_bits += 9;
 
-      for (char *c = argv[current_file]; *c; c++)
+      for (char *c = &entry.path[entry.name]; *c; c++)
       { // counting usage frequency of unique bytes on the file name (or folder name)
         local_number[(unsigned char)(*c)]++;
       }
 
-      if (this_is_not_a_folder(argv[current_file]))
+      if (entry.folder)
       {
-        local_total_size += size = size_of_the_file(argv[current_file]);
-        local_total_bits += 64;
-
-        FILE *original_fp = fopen(argv[current_file], "rb");
-        unsigned char x;
-        for (long int j = 0; j < size; j++)
-        {
-          fread(&x, 1, 1, original_fp);
-          local_number[x]++;
-        }
-        fclose(original_fp);
+        local_total_size += 4096;
+        local_total_bits += 16; // for file_count
       }
       else
       {
-        string temp = argv[current_file];
-        count_in_folder(temp, local_number, local_total_size, local_total_bits);
+        local_total_size += entry.size;
+        local_total_bits += 64;
+        if (ARCHIVE_VERSION != 2) // version 2 archives count their blocks while they are written
+        {
+          input_file input;
+          if (input.open(&entry.path[0]))
+            count_in_file(input, local_number);
+          else
+          {
+#pragma omp critical
+            unreadable = entry.path;
+          }
+        }
       }
     }
 
@@ -139,6 +252,13 @@ int main(int argc, char *argv[])
     }
   }
 
+  if (unreadable.size())
+  {
+    cout << unreadable << " can not be read" << endl
+         << "Process has been terminated" << endl;
+    return 1;
+  }
+
   memcpy(number, total_number, sizeof(number));
   total_size += global_total_size;
   total_bits += global_total_bits;
@@ -150,105 +270,52 @@ int main(int argc, char *argv[])
       letter_count++;
     }
   }
+  STATS.phase("count", ARCHIVE_VERSION == 2 ? 0 : total_size);
 
-  // Creating the base of the translation array
-  ersel array[512]; // Maximum size considering worst case
-  int array_size = 0;
-  ersel *e = array;
-  for (long int *i = number; i < number + 256; i++)
-  {
-    if (*i)
-    {
-      e->right = NULL;
-      e->left = NULL;
-      e->number = *i;
-      e->character = i - number;
-      e++;
-      array_size++;
-    }
-  }
-  sort(array, array + array_size, erselcompare0);
+  // Building the Huffman tree in a flat node pool and assigning its codes
+  // (limited to MAX_CODE_LENGTH bits if the tree is deeper, see huffman_tree_codes in block_format.hpp)
+  huffman_tree tree;
+  huffman_tree_codes(number, tree, MAX_CODE_LENGTH);
+  STATS.phase("tree", 0);
 
-  // Building the Huffman tree
-  ersel *min1 = array, *min2 = array + 1, *current = array + array_size, *notleaf = array + array_size, *isleaf = array + 2;
-  int total_nodes = array_size;
-  for (int i = 0; i < array_size - 1; i++)
+  compressed_fp = fopen(&scompressed[0], "wb");
+  if (!compressed_fp)
   {
-    current->number = min1->number + min2->number;
-    current->left = min1;
-    current->right = min2;
-    min1->bit = "1";
-    min2->bit = "0";
-    current++;
-    total_nodes++;
-
-    if (isleaf >= array + array_size)
-    {
-      min1 = notleaf;
-      notleaf++;
-    }
-    else
-    {
-      if (isleaf->number < notleaf->number)
-      {
-        min1 = isleaf;
-        isleaf++;
-      }
-      else
-      {
-        min1 = notleaf;
-        notleaf++;
-      }
-    }
-
-    if (isleaf >= array + array_size)
-    {
-      min2 = notleaf;
-      notleaf++;
-    }
-    else if (notleaf >= current)
-    {
-      min2 = isleaf;
-      isleaf++;
-    }
-    else
-    {
-      if (isleaf->number < notleaf->number)
-      {
-        min2 = isleaf;
-        isleaf++;
-      }
-      else
-      {
-        min2 = notleaf;
-        notleaf++;
-      }
-    }
+    cout << scompressed << " can not be created" << endl
+         << "Process has been terminated" << endl;
+    return 1;
   }
-
-  // Code assignment
-  ersel *root = current - 1;
-  assign_codes(root, "");
-
-  compressed_fp = fopen(&scompressed[0], "wb");
-  int current_bit_count = 0;
-  unsigned char current_byte = 0;
+  bit_writer writer(compressed_fp);
 
   // Writing first
-  fwrite(&letter_count, 1, 1, compressed_fp);
-  total_bits += 8;
+  if (ARCHIVE_VERSION == 2)
+  {
+    write_archive_magic(writer);
+    total_bits += 40;
+  }
+  else
+  {
+    writer.write_byte(letter_count);
+    total_bits += 8;
+  }
 
   // Writing second (password handling remains unchanged)
   {
-    cout << "If you want a password write any number other than 0" << endl
-         << "If you do not, write 0" << endl;
-    int check_password;
-    cin >> check_password;
+    int check_password = options.password.size();
+    string password = options.password;
+    if (options.ask_password)
+    { // --no-confirm and --password-file skip the questions
+      cout << "If you want a password write any number other than 0" << endl
+           << "If you do not, write 0" << endl;
+      cin >> check_password;
+      if (check_password)
+      {
+        cout << "Enter your password (Do not use whitespaces): ";
+        cin >> password;
+      }
+    }
     if (check_password)
     {
-      string password;
-      cout << "Enter your password (Do not use whitespaces): ";
-      cin >> password;
       int password_length = password.length();
       if (password_length == 0)
       {
@@ -256,7 +323,7 @@ int main(int argc, char *argv[])
              << "Process has been terminated" << endl;
         fclose(compressed_fp);
         remove(&scompressed[0]);
-        return 0;
+        return 1;
       }
       if (password_length > 100)
       {
@@ -264,62 +331,53 @@ int main(int argc, char *argv[])
              << "Process has been terminated" << endl;
         fclose(compressed_fp);
         remove(&scompressed[0]);
-        return 0;
+        return 1;
+      }
+      if (password.find_first_of(" \t") != string::npos)
+      { // possible with --password-file, extract could not ask for it
+        cout << "Password cannot contain whitespaces" << endl
+             << "Process has been terminated" << endl;
+        fclose(compressed_fp);
+        remove(&scompressed[0]);
+        return 1;
+      }
+      writer.write_byte(password_length);
+      for (int i = 0; i < password_length; i++)
+      {
+        writer.write_byte(password[i]);
       }
-      unsigned char password_length_unsigned = password_length;
-      fwrite(&password_length_unsigned, 1, 1, compressed_fp);
-      fwrite(&password[0], 1, password_length, compressed_fp);
       total_bits += 8 + 8 * password_length;
     }
     else
     {
-      fwrite(&check_password, 1, 1, compressed_fp);
+      writer.write_byte(0);
       total_bits += 8;
     }
   }
 
   // Writing third (translation script)
-  char *str_pointer;
   unsigned char len, current_character;
-  string str_arr[256];
-  for (e = array; e < array + array_size; e++)
+  code_table table;
+  if (ARCHIVE_VERSION == 2)
+  { // version 2 archives use canonical codes, only their lengths are written
+    int length[256];
+    huffman_code_lengths(number, length, MAX_CODE_LENGTH);
+    canonical_codes(length, table);
+    write_code_lengths(length, writer);
+  }
+  else
   {
-    str_arr[(e->character)] = e->bit; // Storing the transformation string
-    len = e->bit.length();
-    current_character = e->character;
+    table = tree.table; // the transformation as integer codes
+    for (int i = 0; i < tree.n; i++)
+    {
+      current_character = tree.symbols[i];
+      len = table.length[current_character];
 
-    write_from_uChar(current_character, current_byte, current_bit_count, compressed_fp);
-    write_from_uChar(len, current_byte, current_bit_count, compressed_fp);
-    total_bits += len + 16;
+      writer.write_byte(current_character);
+      writer.write_byte(len);
+      total_bits += len + 16;
 
-    str_pointer = &e->bit[0];
-    while (*str_pointer)
-    {
-      if (current_bit_count == 8)
-      {
-        fwrite(&current_byte, 1, 1, compressed_fp);
-        current_byte = 0;
-        current_bit_count = 0;
-      }
-      switch (*str_pointer)
-      {
-      case '1':
-        current_byte <<= 1;
-        current_byte |= 1;
-        current_bit_count++;
-        break;
-      case '0':
-        current_byte <<= 1;
-        current_bit_count++;
-        break;
-      default:
-        cout << "An error has occurred" << endl
-             << "Compression process aborted" << endl;
-        fclose(compressed_fp);
-        remove(&scompressed[0]);
-        return 1;
-      }
-      str_pointer++;
+      writer.write_symbol(table, current_character);
     }
   }
   if (total_bits % 8)
@@ -328,18 +386,29 @@ int main(int argc, char *argv[])
   }
 
   cout << "The size of the sum of ORIGINAL files is: " << total_size << " bytes" << endl;
-  cout << "The size of the COMPRESSED file will be: " << total_bits / 8 << " bytes" << endl;
-  cout << "Compressed file's size will be [%" << 100 * ((float)total_bits / 8 / total_size) << "] of the original file" << endl;
-  if (total_bits / 8 > total_size)
+  if (ARCHIVE_VERSION == 2)
   {
-    cout << endl
-         << "COMPRESSED FILE'S SIZE WILL BE HIGHER THAN THE SUM OF ORIGINALS" << endl
-         << endl;
+    cout << "The size of the COMPRESSED file will be known after the blocks are translated" << endl;
+  }
+  else
+  {
+    cout << "The size of the COMPRESSED file will be: " << total_bits / 8 << " bytes" << endl;
+    cout << "Compressed file's size will be [%" << 100 * ((float)total_bits / 8 / total_size) << "] of the original file" << endl;
+    if (total_bits / 8 > total_size)
+    {
+      cout << endl
+           << "COMPRESSED FILE'S SIZE WILL BE HIGHER THAN THE SUM OF ORIGINALS" << endl
+           << endl;
+    }
+  }
+  STATS.phase("header", 0);
+  int check = 1;
+  if (options.confirm)
+  {
+    cout << "If you wish to abort this process write 0 and press enter" << endl
+         << "If you want to continue write any other number and press enter" << endl;
+    cin >> check;
   }
-  cout << "If you wish to abort this process write 0 and press enter" << endl
-       << "If you want to continue write any other number and press enter" << endl;
-  int check;
-  cin >> check;
   if (!check)
   {
     cout << endl
@@ -348,92 +417,90 @@ int main(int argc, char *argv[])
     remove(&scompressed[0]);
     return 0;
   }
+  STATS.phase("confirm", 0);
 
-  PROGRESS.MAX = root->number; // setting progress bar
+  PROGRESS.MAX = tree.total; // setting progress bar
+  if (ARCHIVE_VERSION == 2)
+    PROGRESS.MAX = total_size > 0 ? total_size : 1; // file contents are not inside the name table's weights
 
-  // Writing fourth
-  write_file_count(argc - 1, current_byte, current_bit_count, compressed_fp);
-
-  // Prepare thread-local buffers
-  int num_files = argc - 1;
-  vector<vector<unsigned char>> thread_buffers(num_files);
-  vector<int> buffer_bit_counts(num_files, 0);
-
-  // Parallel file compression
-#pragma omp parallel for schedule(dynamic)
-  for (int current_file = 1; current_file < argc; current_file++)
+  // Writing fourth to eighth through the pipeline
+  output_pipeline pipeline(writer, table, 4 * omp_get_max_threads());
+#pragma omp parallel
+#pragma omp single
   {
-    vector<unsigned char> &local_buffer = thread_buffers[current_file - 1];
-    int &local_bit_count = buffer_bit_counts[current_file - 1];
-    unsigned char local_current_byte = 0;
-
-    if (this_is_not_a_folder(argv[current_file]))
-    { // if current is a file and not a folder
-      FILE *local_original_fp = fopen(argv[current_file], "rb");
-      fseek(local_original_fp, 0, SEEK_END);
-      long int size = ftell(local_original_fp);
-      rewind(local_original_fp);
-
-      // Writing fifth
-      local_current_byte <<= 1;
-      local_current_byte |= 1;
-      local_bit_count++;
-
-      // Write file size
-      for (int i = 0; i < 8; i++)
-      {
-        unsigned char temp = (size >> ((7 - i) * 8)) & 0xFF;
-        write_from_uChar(temp, local_current_byte, local_bit_count, local_buffer);
-      }
-
-      // Write file name
-      write_file_name(argv[current_file], str_arr, local_current_byte, local_bit_count, local_buffer);
-
-      // Write file content
-      write_the_file_content(local_original_fp, size, str_arr, local_current_byte, local_bit_count, local_buffer);
-
-      fclose(local_original_fp);
-    }
-    else
-    { // if current is a folder
-      // Writing fifth
-      local_current_byte <<= 1;
-      local_bit_count++;
+    write_file_count(argc - 1, pipeline.header);
+    for (manifest_entry &entry : manifest)
+    {
+      char *name = &entry.path[entry.name];
+      if (!entry.folder)
+      { // if current is a file and not a folder
+        shared_ptr<input_file> input = make_shared<input_file>();
+        if (!input->open(&entry.path[0]))
+        {
+          unreadable = entry.path;
+          break;
+        }
 
-      // Write folder name
-      write_file_name(argv[current_file], str_arr, local_current_byte, local_bit_count, local_buffer);
+        // Writing fifth (version 2 entries start on a byte boundary)
+        directory_entry *entry_place = NULL;
+        if (ARCHIVE_VERSION == 2)
+        {
+          pipeline.header.align();
+          pipeline.header.mark(); // for the central directory, append() moves it to its place inside the archive
+          DIRECTORY.push_back({entry.path, true, input->size, 0, 0});
+          entry_place = &DIRECTORY.back();
+        }
+        pipeline.header.write(1, 1);
 
-      // Write folder content
-      write_the_folder(argv[current_file], str_arr, local_current_byte, local_bit_count, local_buffer);
-    }
+        write_file_size(input->size, pipeline.header); // writes sixth
+        write_file_name(name, table, pipeline.header); // writes seventh
+        pipeline.write_content(input, entry_place);    // writes eighth
+      }
+      else
+      { // if current is a folder
+        // Writing fifth
+        if (ARCHIVE_VERSION == 2)
+        {
+          pipeline.header.align();
+          pipeline.header.mark();
+          DIRECTORY.push_back({entry.path, false, 0, 0, 0});
+        }
+        pipeline.header.write(0, 1);
 
-    // Flush remaining bits in local buffer
-    if (local_bit_count > 0 && local_bit_count < 8)
-    {
-      local_current_byte <<= (8 - local_bit_count);
-      local_buffer.push_back(local_current_byte);
-      local_bit_count = 0;
+        write_file_name(name, table, pipeline.header);       // writes seventh
+        write_file_count(entry.entries, pipeline.header);    // writes fourth, the entries inside it come next
+      }
     }
+    pipeline.finish();
   }
-
-  // Write buffers to compressed file sequentially
-  for (int i = 0; i < num_files; i++)
+  if (unreadable.size())
   {
-    vector<unsigned char> &local_buffer = thread_buffers[i];
-    fwrite(&local_buffer[0], 1, local_buffer.size(), compressed_fp);
+    cout << unreadable << " can not be read" << endl
+         << "Process has been terminated" << endl;
+    fclose(compressed_fp);
+    remove(&scompressed[0]);
+    return 1;
   }
+  STATS.phase("content", total_size);
+
+  if (ARCHIVE_VERSION == 2)
+    write_central_directory(writer, DIRECTORY);
 
   // Flush remaining bits
-  if (current_bit_count > 0 && current_bit_count < 8)
-  {
-    current_byte <<= (8 - current_bit_count);
-    fwrite(&current_byte, 1, 1, compressed_fp);
-  }
+  writer.finish();
 
   fclose(compressed_fp);
-  system("clear");
+  STATS.finish("finish", 0, total_size);
+  PROGRESS.finish();
   cout << endl
        << "Created compressed file: " << scompressed << endl;
+  if (ARCHIVE_VERSION == 2)
+  {
+    cout << "Compressed file's size is " << writer.flushed << " bytes";
+    if (total_size)
+      cout << " [%" << 100 * ((float)writer.flushed / total_size) << "] of the original files";
+    cout << endl;
+  }
   cout << "Compression is complete" << endl;
 
   return 0;
@@ -441,266 +508,40 @@ int main(int argc, char *argv[])
 
 // Modified functions to support thread-local buffers
 
-void write_from_uChar(unsigned char uChar, unsigned char &current_byte, int &current_bit_count, vector<unsigned char> &buffer)
+void write_file_count(int file_count, bit_writer &writer)
 {
-  for (int i = 0; i < 8; i++)
-  {
-    if (current_bit_count == 8)
-    {
-      buffer.push_back(current_byte);
-      current_byte = 0;
-      current_bit_count = 0;
-    }
-    current_byte <<= 1;
-    current_byte |= (uChar >> (7 - i)) & 1;
-    current_bit_count++;
-  }
+  writer.write_byte(file_count % 256);
+  writer.write_byte(file_count / 256);
 }
 
-void write_from_uChar(unsigned char uChar, unsigned char &current_byte, int &current_bit_count, FILE *fp_write)
+void write_file_size(long int size, bit_writer &writer)
 {
   for (int i = 0; i < 8; i++)
   {
-    if (current_bit_count == 8)
-    {
-      fwrite(&current_byte, 1, 1, fp_write);
-      current_byte = 0;
-      current_bit_count = 0;
-    }
-    current_byte <<= 1;
-    current_byte |= (uChar >> (7 - i)) & 1;
-    current_bit_count++;
+    writer.write_byte(size % 256);
+    size /= 256;
   }
 }
 
-void write_file_count(int file_count, unsigned char &current_byte, int &current_bit_count, FILE *compressed_fp)
+void write_file_name(char *file_name, code_table &table, bit_writer &writer)
 {
-  unsigned char temp = file_count % 256;
-  write_from_uChar(temp, current_byte, current_bit_count, compressed_fp);
-  temp = file_count / 256;
-  write_from_uChar(temp, current_byte, current_bit_count, compressed_fp);
-}
-
-void write_file_size(long int size, unsigned char &current_byte, int &current_bit_count, vector<unsigned char> &buffer)
-{
-  for (int i = 0; i < 8; i++)
-  {
-    unsigned char temp = (size >> ((7 - i) * 8)) & 0xFF;
-    write_from_uChar(temp, current_byte, current_bit_count, buffer);
-  }
-}
-
-void write_file_name(char *file_name, string *str_arr, unsigned char &current_byte, int &current_bit_count, vector<unsigned char> &buffer)
-{
-  write_from_uChar(strlen(file_name), current_byte, current_bit_count, buffer);
-  char *str_pointer;
+  writer.write_byte(strlen(file_name));
   for (char *c = file_name; *c; c++)
   {
-    str_pointer = &str_arr[(unsigned char)(*c)][0];
-    while (*str_pointer)
-    {
-      if (current_bit_count == 8)
-      {
-        buffer.push_back(current_byte);
-        current_byte = 0;
-        current_bit_count = 0;
-      }
-      switch (*str_pointer)
-      {
-      case '1':
-        current_byte <<= 1;
-        current_byte |= 1;
-        current_bit_count++;
-        break;
-      case '0':
-        current_byte <<= 1;
-        current_bit_count++;
-        break;
-      default:
-        cout << "An error has occurred" << endl
-             << "Process has been aborted";
-        exit(2);
-      }
-      str_pointer++;
-    }
-  }
-}
-
-void write_the_file_content(FILE *original_fp, long int size, string *str_arr, unsigned char &current_byte, int &current_bit_count, vector<unsigned char> &buffer)
-{
-  unsigned char x;
-  char *str_pointer;
-  for (long int i = 0; i < size; i++)
-  {
-    fread(&x, 1, 1, original_fp);
-    str_pointer = &str_arr[x][0];
-    while (*str_pointer)
-    {
-      if (current_bit_count == 8)
-      {
-        buffer.push_back(current_byte);
-        current_byte = 0;
-        current_bit_count = 0;
-      }
-      switch (*str_pointer)
-      {
-      case '1':
-        current_byte <<= 1;
-        current_byte |= 1;
-        current_bit_count++;
-        break;
-      case '0':
-        current_byte <<= 1;
-        current_bit_count++;
-        break;
-      default:
-        cout << "An error has occurred" << endl
-             << "Process has been aborted";
-        exit(2);
-      }
-      str_pointer++;
-    }
-  }
-}
-
-void write_the_folder(string path, string *str_arr, unsigned char &current_byte, int &current_bit_count, vector<unsigned char> &buffer)
-{
-  FILE *original_fp;
-  path += '/';
-  DIR *dir = opendir(&path[0]), *next_dir;
-  string next_path;
-  struct dirent *current;
-  int file_count = 0;
-  long int size;
-  while ((current = readdir(dir)))
-  {
-    if (current->d_name[0] == '.')
-    {
-      if (current->d_name[1] == 0)
-        continue;
-      if (current->d_name[1] == '.' && current->d_name[2] == 0)
-        continue;
-    }
-    file_count++;
-  }
-  rewinddir(dir);
-  // Writes fourth
-  unsigned char temp = file_count % 256;
-  write_from_uChar(temp, current_byte, current_bit_count, buffer);
-  temp = file_count / 256;
-  write_from_uChar(temp, current_byte, current_bit_count, buffer);
-
-  while ((current = readdir(dir)))
-  { // if current is a file
-    if (current->d_name[0] == '.')
-    {
-      if (current->d_name[1] == 0)
-        continue;
-      if (current->d_name[1] == '.' && current->d_name[2] == 0)
-        continue;
-    }
-
-    next_path = path + current->d_name;
-    if (this_is_not_a_folder(&next_path[0]))
-    {
-      original_fp = fopen(&next_path[0], "rb");
-      fseek(original_fp, 0, SEEK_END);
-      size = ftell(original_fp);
-      rewind(original_fp);
-
-      // Writing fifth
-      current_byte <<= 1;
-      current_byte |= 1;
-      current_bit_count++;
-
-      write_file_size(size, current_byte, current_bit_count, buffer);                              // writes sixth
-      write_file_name(current->d_name, str_arr, current_byte, current_bit_count, buffer);          // writes seventh
-      write_the_file_content(original_fp, size, str_arr, current_byte, current_bit_count, buffer); // writes eighth
-      fclose(original_fp);
-    }
-    else
-    { // if current is a folder
-      // Writing fifth
-      current_byte <<= 1;
-      current_bit_count++;
-
-      write_file_name(current->d_name, str_arr, current_byte, current_bit_count, buffer); // writes seventh
-
-      write_the_folder(next_path, str_arr, current_byte, current_bit_count, buffer);
-    }
+    writer.write_symbol(table, (unsigned char)(*c));
   }
-  closedir(dir);
 }
 
-int this_is_not_a_folder(char *path)
+// Counts usage frequency of bytes inside an input file, piece by piece
+  // version 2 archives don't need it, their blocks are counted while they are written
+void count_in_file(input_file &input, long int *local_number)
 {
-  DIR *temp = opendir(path);
-  if (temp)
+  const unsigned char *data;
+  long int n;
+  if (ARCHIVE_VERSION == 2)
+    return;
+  while ((n = input.next(data)))
   {
-    closedir(temp);
-    return 0;
+    count_bytes(data, n, local_number);
   }
-  return 1;
-}
-
-long int size_of_the_file(char *path)
-{
-  long int size;
-  FILE *fp = fopen(path, "rb");
-  fseek(fp, 0, SEEK_END);
-  size = ftell(fp);
-  fclose(fp);
-  return size;
 }
-
-void count_in_folder(string path, long int *local_number, long int &local_total_size, long int &local_total_bits)
-{
-  FILE *original_fp;
-  path += '/';
-  DIR *dir = opendir(&path[0]), *next_dir;
-  string next_path;
-  local_total_size += 4096;
-  local_total_bits += 16; // for file_count
-  struct dirent *current;
-  while ((current = readdir(dir)))
-  {
-    if (current->d_name[0] == '.')
-    {
-      if (current->d_name[1] == 0)
-        continue;
-      if (current->d_name[1] == '.' && current->d_name[2] == 0)
-        continue;
-    }
-    local_total_bits += 9;
-
-    for (char *c = current->d_name; *c; c++)
-    { // counting usage frequency of bytes on the file name (or folder name)
-      local_number[(unsigned char)(*c)]++;
-    }
-
-    next_path = path + current->d_name;
-
-    if ((next_dir = opendir(&next_path[0])))
-    {
-      closedir(next_dir);
-      count_in_folder(next_path, local_number, local_total_size, local_total_bits);
-    }
-    else
-    {
-      long int size;
-      unsigned char x;
-      local_total_size += size = size_of_the_file(&next_path[0]);
-      local_total_bits += 64;
-
-      original_fp = fopen(&next_path[0], "rb");
-
-      for (long int j = 0; j < size; j++)
-      { // counting usage frequency of bytes inside the file
-        fread(&x, 1, 1, original_fp);
-        local_number[x]++;
-      }
-      fclose(original_fp);
-    }
-  }
-  closedir(dir);
-}
\ No newline at end of file
@@ -3,37 +3,56 @@
 #include <string>
 #include <cstring>
 #include <cstdlib>
+#include <vector>
 #include <dirent.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <climits>
+#include <iomanip>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "progress_bar.hpp"
+#include "stats.hpp"
+#include "bit_reader.hpp"
+#include "decode_table.hpp"
+#include "block_format.hpp"
+#include "block_decoder.hpp"
+#include "archive_reader.hpp"
+#include "output_file.hpp"
+#include "options.hpp"
+#include "stream_mode.hpp"
 
 using namespace std;
 
-const unsigned char check=0b10000000;
-
-struct translation{
-    translation *zero,*one;
-    unsigned char character;
-};
-
 progress PROGRESS;
+run_stats STATS;
+
+// files of version 2 archives that have a central directory are not decoded while the archive is read,
+// they are collected here and decoded at the same time by different threads at the end
+struct extract_job{
+    string path;
+    long int size;
+    long int start,end;     // where the blocks of the file are inside the archive
+    bool has_checksum;
+    unsigned int checksum;
+};
+vector<extract_job> JOBS;
 
-bool this_is_a_file(unsigned char&,int&,FILE*);
-long int read_file_size(unsigned char&,int,FILE*);
-void write_file_name(char*,int,unsigned char&,int&,translation*,FILE*);
-void translate_file(char*,long int,unsigned char&,int&,translation*,FILE*);
-void translate_folder(string,unsigned char&,int&,FILE*,translation*);
-
+bool DIRECT_IO=false;                   // --direct: files of at least direct_io_size bytes bypass the page cache
+const long int direct_io_size=4<<20;
 
-unsigned char process_8_bits_NUMBER(unsigned char&,int,FILE*);
-void process_n_bits_TO_STRING(unsigned char&,int,int&,FILE*,translation*,unsigned char);
+bool translate_file(const char*,archive_reader&);
+bool translate_blocks(const char*,long int,bit_reader&,output_file&,unsigned int&);
+bool translate_jobs(char*,long int);
+int extract_selected(char*,archive_reader&,char**,int);
+void list_archive(archive_reader&);
+void create_parent_folders(const string&);
 
 bool file_exists(char*);
 void change_name_if_exists(char*);
 
-void burn_tree(translation*);
-
 
 
 /*          CONTENT TABLE IN ORDER
@@ -60,6 +79,9 @@ void burn_tree(translation*);
 *whenever we see a new folder we will write seventh then 
     start writing the files(and folders) inside the current folder from fourth to eighth
 **groups from fifth to eighth will be written as much as the file count
+
+version 2 archives start with 0xFF 0xFF 'H' 'F' version instead of letter_count,
+.third only holds code lengths of a canonical table and .eighth is made of blocks (see block_format.hpp)
 */
 
 
@@ -69,253 +91,131 @@ void burn_tree(translation*);
 
 
 int main(int argc,char *argv[]){
-    int letter_count=0,password_length=0;
-    FILE *fp_compressed,*fp_new;
+    archive_options options;
+    if(!parse_options(argc,argv,options)){
+        return 1;
+    }
+    if(options.progress.size())PROGRESS.set_mode(options.progress);
+    DIRECT_IO=options.direct_io;
+    if(options.stream){
+        if(argc>2){
+            cerr<<"Stream mode (-c) takes one file"<<endl;
+            return 1;
+        }
+        return extract_stream(argc==2?argv[1]:"-");
+    }
     if(argc==1){
-        cout<<"Missing file name"<<endl<<"try './extract {{file_name}}'"<<endl;
+        cout<<"Missing file name"<<endl<<"try './extract {{file_name}}'"<<endl
+            <<"or './extract {{file_name}} {{path/inside}} [...]' to extract only some files or folders"<<endl
+            <<"or './extract --list {{file_name}}' to see what is inside"<<endl
+            <<"or './extract -c - < {{compressed_stream}} > {{file_name}}' to decompress a stream"<<endl
+            <<"options: -o {{folder}}, --password-file {{file}}, --no-confirm, -j {{threads}} (see options.hpp)"<<endl;
         return 0;
     }
-    fp_compressed=fopen(argv[1],"rb");
-    if(!fp_compressed){
-        cout<<argv[1]<<" does not exist"<<endl;
+#ifdef _OPENMP
+    if(options.threads)omp_set_num_threads(options.threads);
+#endif
+    STATS.begin("extract",options.stats);
+    archive_reader archive;
+    if(!archive.open(argv[1])){
+        cout<<archive.error<<endl;
+        return 1;
+    }
+    STATS.phase("open",0);
+    if(options.list){       // names and sizes are not protected by the password (the central directory stores them as they are)
+        list_archive(archive);
+        STATS.finish("list",0,0);
         return 0;
     }
-    fseek(fp_compressed,0,SEEK_END);
-    PROGRESS.MAX=ftell(fp_compressed);      //setting progress bar
-    fseek(fp_compressed,0,SEEK_SET);
-
-
-
-    //---------reads .first-----------
-    fread(&letter_count,1,1,fp_compressed);
-    if(letter_count==0)letter_count=256;
-    //-------------------------------
-
-
-
-    //-----------------reads .second--------------------
-        // this code block reads and checks the password
-    fread(&password_length,1,1,fp_compressed);
-    if(password_length){
-        char real_password[password_length+1],password_input[257];
-        fread(real_password,1,password_length,fp_compressed);
-        real_password[password_length]=0;
-        cout<<"Enter password:";
-        cin>>password_input;
-        char *rp=real_password,*pi=password_input;
-        for(;*rp&&*pi;rp++,pi++){
-            if(*rp!=*pi){
-                cout<<"Wrong password"<<endl;
-                fclose(fp_compressed);
-                return 0;
-            }
-        }
-        if(*rp!=*pi){
-            cout<<"Wrong password"<<endl;
-            fclose(fp_compressed);
-            return 0;
+    char archive_path[PATH_MAX];        // translate_jobs opens the archive again after -o changed the directory
+    if(!realpath(argv[1],archive_path)){
+        strcpy(archive_path,argv[1]);
+    }
+    if(options.output.size()){
+        mkdir(options.output.c_str(),0755);
+        if(chdir(options.output.c_str())){
+            cout<<options.output<<" can not be used as the output folder"<<endl;
+            return 1;
         }
-        cout<<"Correct Password"<<endl;
     }
-    //--------------------------------------------------
-
+    PROGRESS.MAX=archive.archive_size;      //setting progress bar
 
 
-    //----------------reads .third---------------------
-        // and stores transformation info into binary translation tree for later use
-    unsigned char current_byte=0,current_character;
-    int current_bit_count=0,len;
-    translation *root=new translation;
-    root->zero=NULL;
-    root->one=NULL;
 
-    for(int i=0;i<letter_count;i++){
-        current_character=process_8_bits_NUMBER(current_byte,current_bit_count,fp_compressed);
-        len=process_8_bits_NUMBER(current_byte,current_bit_count,fp_compressed);
-        if(len==0)len=256;
-        process_n_bits_TO_STRING(current_byte,len,current_bit_count,fp_compressed,root,current_character);
+    //-----------------checks .second--------------------
+        // .first and .third are read by archive.open (see archive_reader.hpp)
+    if(archive.password.size()){
+        string password_input=options.password;
+        if(options.ask_password){
+            cout<<"Enter password:";
+            cin>>password_input;
+        }
+        else if(password_input.empty()){
+            cout<<"This file is password protected, use --password-file"<<endl;
+            return 1;
+        }
+        if(password_input!=archive.password){
+            cout<<"Wrong password"<<endl;
+            return 1;
+        }
+        cout<<"Correct Password"<<endl;
+        STATS.phase("password",0);
     }
     //--------------------------------------------------
 
+    if(argc>2){
+        return extract_selected(archive_path,archive,argv+2,argc-2);
+    }
 
 
 
-
-
-
-
-
-
-
-
-
-    // ---------reads .fourth----------
-        //reads how many folders/files the program is going to create inside the main folder
-    int file_count;
-    file_count=process_8_bits_NUMBER(current_byte,current_bit_count,fp_compressed);
-    file_count+=256*process_8_bits_NUMBER(current_byte,current_bit_count,fp_compressed);
-        // File count was written to the compressed file from least significiant byte 
-        // to most significiant byte to make sure system's endianness
-        // does not affect the process and that is why we are processing size information like this
-    // --------------------------------
-
-
-
-    for(int current_file=0;current_file<file_count;current_file++){
-
-        if(this_is_a_file(current_byte,current_bit_count,fp_compressed)){   // reads .fifth and goes inside if this is a file
-
-            long int size=read_file_size(current_byte,current_bit_count,fp_compressed);  // reads .sixth
-
-            //---------------translates .seventh---------------------
-            int file_name_length=process_8_bits_NUMBER(current_byte,current_bit_count,fp_compressed);
-            char newfile[file_name_length+4];
-            write_file_name(newfile,file_name_length,current_byte,current_bit_count,root,fp_compressed);
+    // creates the files and folders from .fourth to .eighth in the order they were written
+        // the ones that were given to the compressor get another name if something with their name
+        // already exists here, everything inside them goes below that name
+    archive_entry entry;
+    string top_name,new_top_name;
+    long int walk_bytes=0,job_bytes=0;      // files decoded during the walk and by translate_jobs
+    bool complete=true;
+    while(archive.next(entry)){
+        if(entry.depth==0){
+            top_name=entry.name;
+            char newfile[entry.name.size()+4];
+            strcpy(newfile,entry.name.c_str());
             change_name_if_exists(newfile);
-            //--------------------------------------------------
-
-            translate_file(newfile,size,current_byte,current_bit_count,root,fp_compressed); //translates .eighth
+            new_top_name=newfile;
         }
-        else{   //if this is a folder
-            //---------------translates .seventh---------------------
-            int file_name_length=process_8_bits_NUMBER(current_byte,current_bit_count,fp_compressed);
-            char newfile[file_name_length+4];
-            write_file_name(newfile,file_name_length,current_byte,current_bit_count,root,fp_compressed);
-            change_name_if_exists(newfile);
-            //--------------------------------------------------
-            mkdir(newfile,0755);
-            string folder_name=newfile;
-            translate_folder(folder_name,current_byte,current_bit_count,fp_compressed,root);
+        string path=new_top_name+entry.path.substr(top_name.size());
+        if(!entry.is_file){
+            mkdir(path.c_str(),0755);
         }
-    }
-
-
-    fclose(fp_compressed);
-    burn_tree(root);
-    system("clear");
-    cout<<"Decompression is complete"<<endl;
-}
-
-
-
-// translate_folder function is used for creating files and folders inside given path
-// by using information from the compressed file.
-    // whenever it creates another file it will recursively call itself with path of the newly created file 
-    // and in this way translates the compressed file.
-void translate_folder(string path,unsigned char &current_byte,int &current_bit_count,FILE *fp_compressed,translation *root){
-    path+='/';
-    string new_path;
-    
-    // ---------reads .fourth----------
-        //reads how many folders/files the program will create inside the current folder
-    int file_count;
-    file_count=process_8_bits_NUMBER(current_byte,current_bit_count,fp_compressed);
-    file_count+=256*process_8_bits_NUMBER(current_byte,current_bit_count,fp_compressed);
-    // --------------------------------
-
-
-
-    for(int current_file=0;current_file<file_count;current_file++){
-        if(this_is_a_file(current_byte,current_bit_count,fp_compressed)){   //checks .fifth
-            long int size=read_file_size(current_byte,current_bit_count,fp_compressed);  // reads .sixth
-
-            //---------------translates .seventh---------------------
-            int file_name_length=process_8_bits_NUMBER(current_byte,current_bit_count,fp_compressed);
-            char newfile[file_name_length+4];
-            write_file_name(newfile,file_name_length,current_byte,current_bit_count,root,fp_compressed);
-            //--------------------------------------------------
-
-            new_path=path+newfile;
-            translate_file(&new_path[0],size,current_byte,current_bit_count,root,fp_compressed); //translates .eighth
+        else if(entry.end){
+            // the file is only created here (so that change_name_if_exists sees it), translate_jobs decodes it later
+            JOBS.push_back({path,entry.size,entry.start,entry.end,entry.has_checksum,entry.checksum});
+            job_bytes+=entry.size;
+            FILE *fp_new=fopen(path.c_str(),"wb");
+            if(fp_new)fclose(fp_new);
         }
-        else{   //if this is a folder
-            //---------------translates .seventh---------------------
-            int file_name_length=process_8_bits_NUMBER(current_byte,current_bit_count,fp_compressed);
-            char newfile[file_name_length+4];
-            write_file_name(newfile,file_name_length,current_byte,current_bit_count,root,fp_compressed);
-            //--------------------------------------------------
-            new_path=path+newfile;
-            mkdir(&new_path[0],0755);
-            translate_folder(new_path,current_byte,current_bit_count,fp_compressed,root);
+        else{
+            if(!translate_file(path.c_str(),archive))complete=false;
+            walk_bytes+=entry.size;
         }
     }
-
-}
-
-
-// burn_tree function is used for deallocating translation tree
-void burn_tree(translation *node){
-    if(node->zero)burn_tree(node->zero);
-    if(node->one)burn_tree(node->one);
-    delete node;
-}
-
-
-
-// process_n_bits_TO_STRING function reads n successive bits from the compressed file
-// and stores it in a leaf of the translation tree,
-// after creating that leaf and sometimes after creating nodes that are binding that leaf to the tree.
-void process_n_bits_TO_STRING(unsigned char &current_byte,int n,int &current_bit_count,FILE *fp_read,translation *node,unsigned char uChar){
-    for(int i=0;i<n;i++){
-        if(current_bit_count==0){
-            fread(&current_byte,1,1,fp_read);
-            current_bit_count=8;
-        }
-
-        switch(current_byte&check){
-            case 0:
-            if(!(node->zero)){
-                node->zero=new translation;
-                node->zero->zero=NULL;
-                node->zero->one=NULL;
-            }
-            node=node->zero;
-            break;
-            case 128:
-            if(!(node->one)){
-                node->one=new translation;
-                node->one->zero=NULL;
-                node->one->one=NULL;
-            }
-            node=node->one;
-            break;
-        }
-        current_byte<<=1;
-        current_bit_count--;
+    STATS.phase("walk",walk_bytes);
+
+    long int first_entry=archive.entry_offsets.size()?archive.entry_offsets[0]:0;
+    archive.close();
+    if(!translate_jobs(archive_path,first_entry))complete=false;
+    STATS.finish("jobs",job_bytes,walk_bytes+job_bytes);
+    PROGRESS.finish();
+    if(!complete){
+        cout<<"Decompression is not complete"<<endl;
+        return 1;
     }
-    node->character=uChar;
-}
-
-
-
-// process_8_bits_NUMBER reads 8 successive bits from compressed file
-    //(does not have to be in the same byte)
-// and returns it in unsigned char form
-unsigned char process_8_bits_NUMBER(unsigned char &current_byte,int current_bit_count,FILE *fp_read){
-    unsigned char val,temp_byte;
-    fread(&temp_byte,1,1,fp_read);
-    val=current_byte|(temp_byte>>current_bit_count);
-    current_byte=temp_byte<<8-current_bit_count;
-    return val;
+    cout<<"Decompression is complete"<<endl;
 }
 
 
 
-//checks if next input is either a file or a folder
-    //returns 1 if it is a file
-    //returns 0 if it is a folder
-bool this_is_a_file(unsigned char &current_byte,int &current_bit_count,FILE *fp_compressed){
-    bool val;
-    if(current_bit_count==0){
-        fread(&current_byte,1,1,fp_compressed);
-        current_bit_count=8;
-    }
-    val=current_byte&check;
-    current_byte<<=1;
-    current_bit_count--;
-    return val;
-}
-
 void change_name_if_exists(char *name){
     char *i;
     int copy_count;
@@ -324,6 +224,8 @@ void change_name_if_exists(char *name){
         for(i=name;*i;i++){
             if(*i=='.')
             dot_pointer=i;
+            else if(*i=='/')        // only a dot of the last part of a path starts an extension
+            dot_pointer=NULL;
         }
         if(dot_pointer){
             string s=dot_pointer;
@@ -364,73 +266,198 @@ bool file_exists(char *name){
     return 0;
 }
 
-// returns file's size
-long int read_file_size(unsigned char &current_byte,int current_bit_count,FILE *fp_compressed){
-    long int size=0;
-    {
-        long int multiplier=1;
-        for(int i=0;i<8;i++){
-            size+=process_8_bits_NUMBER(current_byte,current_bit_count,fp_compressed)*multiplier;
-            multiplier*=256;
-        }
+
+
+// This function translates the current file of the archive and writes it to a newly created file
+    // the file is decoded straight into the buffer of an output_file that is kept for the next files
+    // (a file that can't be created is skipped, archive.next() moves past its content)
+    // returns false (after printing why) if the file can't be created or written
+bool translate_file(const char *path,archive_reader &archive){
+    static output_file out;
+    if(!out.open(path,DIRECT_IO&&archive.unread>=direct_io_size)){
+        cout<<path<<" can not be created"<<endl;
+        return false;
+    }
+    while(archive.unread){
+        long int n=min(archive.unread,(long int)output_file::buffer_size);
+        archive.read(out.reserve(n),n);
+        out.commit(n);
+        PROGRESS.current(archive.position());   //updating progress bar (translate_blocks does it otherwise)
     }
-    PROGRESS.current(ftell(fp_compressed));    //updating progress bar
-    return size;
-    // Size was written to the compressed file from least significiant byte 
-    // to the most significiant byte to make sure system's endianness
-    // does not affect the process and that is why we are processing size information like this
+    if(!out.close()){
+        cout<<path<<" could not be written completely"<<endl;
+        return false;
+    }
+    return true;
 }
 
 
 
-// Decodes current file's name and writes file name to newfile char array
-void write_file_name(char *newfile,int file_name_length,unsigned char &current_byte,int &current_bit_count,translation *root,FILE *fp_compressed){
-    translation *node;
-    newfile[file_name_length]=0;
-    for(int i=0;i<file_name_length;i++){
-            node=root;
-            while(node->zero||node->one){
-                if(current_bit_count==0){
-                    fread(&current_byte,1,1,fp_compressed);
-                    current_bit_count=8;
-                }
-                if(current_byte&check){
-                    node=node->one;
-                }
-                else{
-                    node=node->zero;
+// translates .eighth of a version 2 archive block by block and writes it to a newly created file through out
+    // blocks are decoded straight into out's buffer, which goes to the file 1 MiB at a time
+    // crc becomes the CRC-32 of what was written, the compressed length of every block goes to the progress
+    // returns false (after printing why) if the file can't be created or written
+bool translate_blocks(const char *path,long int size,bit_reader &in,output_file &out,unsigned int &crc){
+    crc=0;
+    if(!out.open(path,DIRECT_IO&&size>=direct_io_size)){
+        #pragma omp critical
+        cout<<path<<" can not be created"<<endl;
+        return false;
+    }
+    decode_table table;
+    in.align();
+    long int position=in.position();
+    while(size>0){
+        int mode;
+        long int n=read_block_header(in,mode,size);
+        unsigned char *data=out.reserve(n);
+        decode_block_body(in,table,mode,n,data);
+        crc=crc32_update(crc,data,n);
+        out.commit(n);
+        size-=n;
+        PROGRESS.add(in.position()-position);
+        position=in.position();
+    }
+    if(!out.close()){
+        #pragma omp critical
+        cout<<path<<" could not be written completely"<<endl;
+        return false;
+    }
+    return true;
+}
+
+
+
+// decodes the files that were collected while the archive was read, every thread reads the archive
+// through its own FILE and writes its own files through its own output_file
+    // returns false if the archive can't be opened again or a file can't be created or written
+bool translate_jobs(char *archive,long int first_entry){
+    bool complete=true;
+    if(JOBS.size())PROGRESS.current(first_entry);
+    #pragma omp parallel
+    {
+        output_file out;
+        #pragma omp for schedule(dynamic)
+        for(long int i=0;i<(long int)JOBS.size();i++){
+            FILE *fp=fopen(archive,"rb");
+            if(!fp){
+                #pragma omp critical
+                {
+                    if(complete)cout<<archive<<" can not be opened"<<endl;
+                    complete=false;
                 }
-                current_byte<<=1;           
-                current_bit_count--;
+                continue;
+            }
+            bit_reader in(fp);
+            in.seek(JOBS[i].start);
+            unsigned int crc;
+            bool written=translate_blocks(JOBS[i].path.c_str(),JOBS[i].size,in,out,crc);
+            fclose(fp);
+            if(!written){
+                #pragma omp critical
+                complete=false;
             }
-            newfile[i]=node->character;
+            else if(JOBS[i].has_checksum&&crc!=JOBS[i].checksum)decode_table::corrupted();
         }
+    }
+    return complete;
 }
 
 
 
-// This function translates compressed file from info that is now stored in the translation tree
-    // then writes it to a newly created file
-void translate_file(char *path,long int size,unsigned char &current_byte,int &current_bit_count,translation *root,FILE *fp_compressed){
-    translation *node;
-    FILE *fp_new=fopen(path,"wb");
-    for(long int i=0;i<size;i++){
-        node=root;
-        while(node->zero||node->one){
-            if(current_bit_count==0){
-                fread(&current_byte,1,1,fp_compressed);
-                current_bit_count=8;
-            }
-            if(current_byte&check){
-                node=node->one;
+// extracts only the given files and folders (with everything inside them) of the archive
+    // they are written to the same path below the current folder, missing parent folders are created
+    // and files that already exist are replaced. With a central directory only the requested entries are read
+int extract_selected(char *archive_path,archive_reader &archive,char **paths,int count){
+    long int bytes=0;
+    bool complete=true;
+    for(int i=0;i<count;i++){
+        string wanted=paths[i];
+        while(wanted.size()>1&&wanted.back()=='/')wanted.pop_back();
+        if(i&&archive.directory.empty()&&!archive.open(archive_path)){    // a walk can't go back
+            cout<<archive.error<<endl;
+            return 1;
+        }
+        archive_entry entry;
+        if(!archive.find(wanted,entry)){
+            cout<<wanted<<" is not inside the archive"<<endl;
+            return 1;
+        }
+        int depth=entry.depth;
+        do{
+            create_parent_folders(entry.path);
+            if(entry.is_file){
+                if(!translate_file(entry.path.c_str(),archive))complete=false;
+                bytes+=entry.size;
             }
             else{
-                node=node->zero;
+                mkdir(entry.path.c_str(),0755);
             }
-            current_byte<<=1;           
-            current_bit_count--;
+        }while(archive.next(entry)&&entry.depth>depth);
+    }
+    STATS.finish("selected",bytes,bytes);
+    if(!complete){
+        cout<<"Decompression is not complete"<<endl;
+        return 1;
+    }
+    cout<<"Decompression is complete"<<endl;
+    return 0;
+}
+
+
+
+void create_parent_folders(const string &path){
+    for(size_t i=path.find('/',1);i!=string::npos;i=path.find('/',i+1)){
+        mkdir(path.substr(0,i).c_str(),0755);
+    }
+}
+
+
+
+// prints the files and folders of the archive with their sizes and how much of the archive they take
+    // with a central directory nothing but the directory is read, otherwise the archive is walked
+    // (block mode archives skip over the blocks, version 1 archives have to decode the content to get past it)
+void list_archive(archive_reader &archive){
+    vector<directory_entry> entries=archive.directory;
+    vector<long int> ends;
+    if(entries.size()){
+        for(size_t i=0;i<entries.size();i++){
+            ends.push_back(i+1<entries.size()?entries[i+1].offset:archive.directory_start);
         }
-        fwrite(&(node->character),1,1,fp_new);
     }
-        fclose(fp_new);
-}
\ No newline at end of file
+    else{
+        archive_entry entry;
+        for(;;){
+            archive.skip_content();
+            long int start=archive.position();
+            if(ends.size())ends.back()=start;
+            if(!archive.next(entry))break;
+            entries.push_back({entry.path,entry.is_file,entry.size,0,start});
+            ends.push_back(start);
+        }
+    }
+    long int total_size=0,total_compressed=0,files=0;
+    cout<<setw(14)<<"size"<<setw(14)<<"compressed"<<setw(8)<<"ratio"<<"  path"<<endl;
+    for(size_t i=0;i<entries.size();i++){
+        const directory_entry &entry=entries[i];
+        long int compressed=ends[i]-entry.offset;
+        total_compressed+=compressed;
+        cout<<setw(14);
+        if(entry.is_file){
+            cout<<entry.size;
+            total_size+=entry.size;
+            files++;
+        }
+        else{
+            cout<<"-";
+        }
+        cout<<setw(14)<<compressed<<setw(7);
+        if(entry.is_file&&entry.size)cout<<fixed<<setprecision(1)<<100.0*compressed/entry.size<<'%';
+        else cout<<"-"<<' ';
+        cout<<"  "<<entry.path<<(entry.is_file?"":"/")<<endl;
+    }
+    cout<<setw(14)<<total_size<<setw(14)<<archive.archive_size<<setw(7);
+    if(total_size)cout<<fixed<<setprecision(1)<<100.0*archive.archive_size/total_size<<'%';
+    else cout<<"-"<<' ';
+    cout<<"  "<<files<<" files, "<<entries.size()-files<<" folders"<<endl;
+}
@@ -0,0 +1,536 @@
+#ifndef ARCHIVE_READER_HPP
+#define ARCHIVE_READER_HPP
+
+#include<cstdio>
+#include<cstdint>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<memory>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include "bit_reader.hpp"
+#include "decode_table.hpp"
+#include "block_format.hpp"
+#include "block_decoder.hpp"
+
+/*  Reading archives entry by entry
+    archive_reader walks the files and folders of an archive (either version) in the order they were written
+    and decodes the content of a file only when it is asked for. extract is built on it, and other programs
+    can use it to take single files out of an archive without writing anything to disk:
+
+        archive_reader archive;
+        archive_entry entry;
+        if(archive.open("a.compressed")&&archive.password==password&&archive.find("folder/file.txt",entry)){
+            std::vector<unsigned char> data(entry.size);
+            archive.read(&data[0],entry.size);      // decoded straight into data
+        }
+
+    read_entry and extract_entry_to_file (at the end of this file) do exactly that.
+    Content that is not read is skipped: version 2 archives seek over it (with the central directory)
+    or over whole blocks (without it), version 1 archives have to decode it. With a central directory
+    find() goes straight to the entry and whatever is read is checked against the stored checksum.
+    Corrupted archives end up in decode_table::corrupted(), which ends the program unless the calling thread
+    replaced the handler (read_entry and extract_entry_to_file make it throw and return an error instead).
+*/
+
+struct archive_entry{
+    std::string path;           // "folder/file", the way it was given to the compressor
+    std::string name;           // last part of path
+    int depth;                  // 0 for the files and folders that were given to the compressor
+    bool is_file;
+    long int size;              // 0 for folders
+    long int start,end;         // where the blocks of a file are (version 2 archives with a central directory), end is 0 otherwise
+    bool has_checksum;          // the archive has a central directory, checksum is the CRC-32 of the file's content
+    unsigned int checksum;
+};
+
+
+
+// binary translation tree of version 1 archives, only used while their decode table is built
+    // All nodes are inside one array (reserved for the 511 nodes of a full tree of 256 bytes) and refer to
+    // their children by 16 bit indices. Node 0 is the root, which is nobody's child, so 0 also means "no child".
+    // A child is always added after its parent, so going through the array backwards visits children first
+struct translation_tree{
+    struct node{
+        uint16_t child[2];
+        uint16_t height;            // number of edges between the node and its deepest leaf
+        unsigned char character;
+    };
+    std::vector<node> nodes;
+
+    translation_tree(){
+        nodes.reserve(511);
+        nodes.push_back({{0,0},0,0});
+    }
+    bool is_leaf(unsigned int i) const{
+        return !nodes[i].child[0]&&!nodes[i].child[1];
+    }
+    void find_heights(){
+        for(size_t i=nodes.size();i-->0;){
+            node &x=nodes[i];
+            int zero=x.child[0]?nodes[x.child[0]].height+1:0;
+            int one=x.child[1]?nodes[x.child[1]].height+1:0;
+            x.height=zero>one?zero:one;
+        }
+    }
+};
+
+// process_n_bits_TO_STRING function reads n successive bits from the compressed file
+// and stores it in a leaf of the translation tree,
+// after creating that leaf and sometimes after creating nodes that are binding that leaf to the tree.
+    // (more nodes than 16 bit indices can reach only come from a corrupted third section)
+inline void process_n_bits_TO_STRING(bit_reader &in,int n,translation_tree &tree,unsigned char uChar){
+    unsigned int node=0;
+    for(int i=0;i<n;i++){
+        int bit=in.read_bits(1);
+        if(!tree.nodes[node].child[bit]){
+            if(tree.nodes.size()>UINT16_MAX)decode_table::corrupted();
+            tree.nodes[node].child[bit]=tree.nodes.size();
+            tree.nodes.push_back({{0,0},0,0});
+        }
+        node=tree.nodes[node].child[bit];
+    }
+    tree.nodes[node].character=uChar;
+}
+
+// fill_decode_table creates a table of 2^bits entries for the codes that continue below node
+// and returns where that table starts inside table.entries
+    // every index is walked down the tree bit by bit (most significant bit first),
+    // if it reaches a leaf the entry holds that leaf's character,
+    // if it is still on a node after 'bits' steps the entry is linked to a new table created for that node
+inline unsigned int fill_decode_table(decode_table &table,const translation_tree &tree,unsigned int node,int bits){
+    unsigned int start=table.entries.size();
+    table.entries.resize(start+(1<<bits));
+    for(unsigned int index=0;index<(1u<<bits);index++){
+        int current=node;           // -1 once the bits lead to a child that does not exist
+        int depth=0;
+        while(current>=0&&!tree.is_leaf(current)&&depth<bits){
+            unsigned int child=tree.nodes[current].child[(index>>(bits-1-depth))&1];
+            current=child?child:-1;
+            depth++;
+        }
+        decode_entry entry={0,{0,0},0,0};
+        if(current>=0&&tree.is_leaf(current)){
+            entry.symbol[0]=tree.nodes[current].character;
+            entry.length=depth;
+        }
+        else if(current>=0){
+            int height=tree.nodes[current].height;
+            int sub_bits=height<decode_table::BITS?height:decode_table::BITS;
+            entry.link=fill_decode_table(table,tree,current,sub_bits);
+            entry.length=sub_bits;
+        }
+        table.entries[start+index]=entry;
+    }
+    return start;
+}
+
+inline void build_decode_table(decode_table &table,translation_tree &tree){
+    tree.find_heights();
+    table.entries.clear();
+    fill_decode_table(table,tree,0,decode_table::BITS);
+    table.pair_symbols();
+}
+
+
+
+struct archive_reader{
+    FILE *fp=NULL;
+    std::string error;                  // why open() failed
+    int version=1;
+    std::string password;               // empty if the archive has no password, the caller compares it
+    long int archive_size=0;
+    std::vector<directory_entry> directory;     // central directory of version 2 archives, empty if there is none
+    std::vector<long int> entry_offsets;        // where every entry starts (from the central directory), empty without it
+    long int directory_start=0;                 // where the central directory starts, the content of the last file ends there
+
+    std::unique_ptr<bit_reader> in;
+    decode_table table;                 // translates names (and the content of version 1 archives)
+
+    // where the walk is: the folders that are open and how many of their files and folders are not read yet
+    struct open_folder{
+        std::string path;
+        int left;
+    };
+    std::vector<open_folder> folders;
+    size_t next_entry=0;                // next offset of entry_offsets that has to match
+    archive_entry current;
+    long int unread=0;                  // bytes of the current file that have not been given out
+    long int undecoded=0;               // bytes of the current file whose blocks have not been decoded
+    decode_table block_table;
+    std::vector<unsigned char> block;   // a decoded block that has not been given out completely
+    long int block_used=0,block_length=0;
+    unsigned int checksum=0;            // of what has been given out of the current file
+
+    archive_reader(){}
+    archive_reader(const archive_reader&)=delete;
+    archive_reader& operator=(const archive_reader&)=delete;
+    ~archive_reader(){
+        close();
+    }
+
+    void close(){
+        in.reset();
+        if(fp)fclose(fp);
+        fp=NULL;
+        folders.clear();
+        directory.clear();
+        entry_offsets.clear();
+        next_entry=0;
+        unread=undecoded=0;
+        block_used=block_length=0;
+    }
+
+    // reads everything up to the first file or folder, returns false (error tells why) if it is not an archive
+    bool open(const char *path){
+        close();
+        version=1;
+        password.clear();
+        fp=fopen(path,"rb");
+        if(!fp){
+            error=std::string(path)+" does not exist";
+            return false;
+        }
+        fseek(fp,0,SEEK_END);
+        archive_size=ftell(fp);
+        fseek(fp,0,SEEK_SET);
+
+        int letter_count=0,password_length=0;
+        fread(&letter_count,1,1,fp);
+        fread(&password_length,1,1,fp);
+        if(letter_count==archive_magic[0]&&password_length==archive_magic[1]){
+            // a version 1 archive can't start like this because its password can't be longer than 100 characters
+            unsigned char rest[3]={0,0,0};
+            fread(rest,1,3,fp);
+            if(rest[0]!=archive_magic[2]||rest[1]!=archive_magic[3]){
+                error=std::string(path)+" is not a compressed file";
+                close();
+                return false;
+            }
+            if(rest[2]!=block_format_version){
+                error=std::string(path)+" was created by a newer version (format version "+std::to_string(rest[2])+")";
+                close();
+                return false;
+            }
+            version=2;
+            password_length=0;
+            fread(&password_length,1,1,fp);
+            long int here=ftell(fp);
+            read_central_directory();
+            fseek(fp,here,SEEK_SET);
+        }
+        else if(letter_count==0)letter_count=256;
+
+        if(password_length){
+            std::vector<char> real_password(password_length);
+            fread(&real_password[0],1,password_length,fp);
+            password.assign(real_password.begin(),real_password.end());
+            password.resize(strlen(password.c_str()));
+        }
+
+        // version 2 archives only store code lengths, version 1 archives store the codes and
+        // their table is built from the translation tree
+        in.reset(new bit_reader(fp));
+        if(version==2){
+            read_code_lengths(*in,table);
+        }
+        else{
+            translation_tree tree;
+            for(int i=0;i<letter_count;i++){
+                unsigned char current_character=in->read_bits(8);
+                int len=in->read_bits(8);
+                if(len==0)len=256;
+                process_n_bits_TO_STRING(*in,len,tree,current_character);
+            }
+            build_decode_table(table,tree);
+        }
+        folders.push_back({"",read_count()});
+        return true;
+    }
+
+    // reads the central directory at the end of a version 2 archive
+        // returns false (and leaves directory and entry_offsets empty) if the archive has none
+    bool read_central_directory(){
+        unsigned char trailer[central_directory_trailer_size];
+        if(fseek(fp,-central_directory_trailer_size,SEEK_END))return false;
+        long int trailer_start=ftell(fp);
+        if(fread(trailer,1,central_directory_trailer_size,fp)!=(size_t)central_directory_trailer_size)return false;
+        if(memcmp(trailer+16,central_directory_magic,4))return false;
+        long int count=little_endian(trailer,8),start=little_endian(trailer+8,8);
+        if(count<0||start<0||start>trailer_start)return false;
+        fseek(fp,start,SEEK_SET);
+        std::vector<unsigned char> data(trailer_start-start+1);
+        if(fread(&data[0],1,trailer_start-start,fp)!=(size_t)(trailer_start-start))return false;
+        const unsigned char *p=&data[0],*stop=p+trailer_start-start;
+        std::vector<directory_entry> entries;
+        std::vector<long int> offsets;
+        for(long int i=0;i<count;i++){
+            directory_entry entry={"",true,0,0,0};
+            if(stop-p<23)return false;
+            entry.offset=little_endian(p,8);
+            entry.size=little_endian(p+8,8);
+            entry.checksum=little_endian(p+16,4);
+            entry.is_file=p[20];
+            long int length=little_endian(p+21,2);
+            p+=23;
+            if(stop-p<length)return false;
+            entry.path.assign((const char*)p,length);
+            p+=length;
+            entries.push_back(entry);
+            if(entry.offset<0||entry.offset>=start)decode_table::corrupted();
+            offsets.push_back(entry.offset);
+        }
+        if(p!=stop)return false;
+        directory.swap(entries);
+        entry_offsets.swap(offsets);
+        directory_start=start;
+        return true;
+    }
+
+    static long int little_endian(const unsigned char *p,int bytes){
+        long int value=0;
+        for(int i=bytes-1;i>=0;i--)value=value<<8|p[i];
+        return value;
+    }
+
+    // file_count (.fourth) was written from least significant byte to most significant byte
+    int read_count(){
+        int count=in->read_bits(8);
+        return count+256*in->read_bits(8);
+    }
+
+    // offset of the next unread byte of the archive
+    long int position(){
+        return in->position();
+    }
+
+    // moves to the next file or folder, returns false after the last one
+        // whatever was not read of the previous file is skipped
+    bool next(archive_entry &entry){
+        skip_content();
+        while(folders.size()&&folders.back().left==0)folders.pop_back();
+        if(folders.empty())return false;
+        folders.back().left--;
+        current.depth=folders.size()-1;
+
+        // .fifth, in version 2 archives every file or folder starts on a byte boundary
+        if(version==2){
+            in->align();
+            if(entry_offsets.size()){
+                if(next_entry>=entry_offsets.size()||in->position()!=entry_offsets[next_entry])decode_table::corrupted();
+                next_entry++;
+            }
+        }
+        current.is_file=in->read_bits(1);
+        current.size=0;
+        if(current.is_file){
+            // .sixth was written from least significant byte to most significant byte
+            for(int i=0;i<8;i++)current.size|=(long int)in->read_bits(8)<<(8*i);
+            if(current.size<0)decode_table::corrupted();
+            // every byte of a version 1 file takes at least one bit
+            if(version==1&&current.size/8>archive_size-in->position())decode_table::corrupted();
+        }
+
+        // .seventh
+        int name_length=in->read_bits(8);
+        current.name.resize(name_length);
+        if(name_length)table.decode(*in,(unsigned char*)&current.name[0],name_length);
+        current.path=folders.back().path+current.name;
+
+        current.start=current.end=0;
+        current.has_checksum=false;
+        current.checksum=0;
+        if(current.is_file){
+            unread=undecoded=current.size;
+            block_used=block_length=0;
+            if(directory.size()){
+                const directory_entry &listed=directory[next_entry-1];
+                if(!listed.is_file||listed.size!=current.size)decode_table::corrupted();
+                current.has_checksum=true;
+                current.checksum=listed.checksum;
+            }
+            checksum=0;
+            if(version==2){
+                in->align();
+                current.start=in->position();
+                if(entry_offsets.size()){
+                    current.end=next_entry<entry_offsets.size()?entry_offsets[next_entry]:directory_start;
+                    if(current.end<current.start)decode_table::corrupted();
+                }
+            }
+        }
+        else{
+            folders.push_back({current.path+'/',read_count()});
+        }
+        entry=current;
+        return true;
+    }
+
+    // finds the file or folder at path
+        // with a central directory it goes straight there and next() continues inside it
+        // (only the files and folders inside a folder, their depth counts from the found one),
+        // otherwise it walks the entries after the current one
+    bool find(const std::string &path,archive_entry &entry){
+        if(directory.empty()){
+            while(next(entry)){
+                if(entry.path==path)return true;
+            }
+            return false;
+        }
+        for(size_t i=0;i<directory.size();i++){
+            if(directory[i].path!=path)continue;
+            unread=undecoded=0;
+            block_used=block_length=0;
+            folders.assign(1,{"",1});
+            next_entry=i;
+            in->seek(entry_offsets[i]);
+            next(entry);
+            current.path=entry.path=path;
+            if(!entry.is_file)folders.back().path=path+'/';
+            return true;
+        }
+        return false;
+    }
+
+    // the current file's checksum is updated with every piece that is given out and checked after the last one
+        // (codes that were taken from beyond the end of the archive mean that it was cut off)
+    void given(const unsigned char *data,long int n){
+        if(in->position()>archive_size)decode_table::corrupted();
+        if(!current.has_checksum)return;
+        checksum=crc32_update(checksum,data,n);
+        if(unread==0&&checksum!=current.checksum)decode_table::corrupted();
+    }
+
+    // decodes the next n bytes of the current file into out
+        // whole blocks that fit are decoded straight into out, so reading a file in one call copies nothing
+    void read(unsigned char *out,long int n){
+        if(n>unread)decode_table::corrupted();
+        unread-=n;
+        unsigned char *first=out;
+        long int total=n;
+        if(version==1){
+            undecoded-=n;
+            table.decode(*in,out,n);
+            given(first,total);
+            return;
+        }
+        while(n>0){
+            if(block_used<block_length){
+                long int m=std::min(n,block_length-block_used);
+                memcpy(out,&block[block_used],m);
+                block_used+=m;
+                out+=m;
+                n-=m;
+                continue;
+            }
+            int mode;
+            long int m=read_block_header(*in,mode,undecoded);
+            undecoded-=m;
+            if(m<=n){
+                decode_block_body(*in,block_table,mode,m,out);
+                out+=m;
+                n-=m;
+            }
+            else{
+                if((long int)block.size()<m)block.resize(m);
+                decode_block_body(*in,block_table,mode,m,&block[0]);
+                block_used=0;
+                block_length=m;
+            }
+        }
+        given(first,total);
+    }
+
+    // moves past whatever is left of the current file
+    void skip_content(){
+        if(!unread)return;
+        unread=0;
+        block_used=block_length=0;
+        if(version==2&&current.end){
+            in->seek(current.end);
+        }
+        else if(version==2){
+            while(undecoded>0){
+                int mode;
+                long int n=read_block_header(*in,mode,undecoded);
+                skip_block_body(*in,mode,n);
+                undecoded-=n;
+            }
+        }
+        else{
+            unsigned char buffer[1<<14];
+            for(long int left=undecoded;left>0;left-=sizeof(buffer)){
+                table.decode(*in,buffer,std::min(left,(long int)sizeof(buffer)));
+            }
+        }
+        undecoded=0;
+    }
+};
+
+
+
+// decodes the file at 'path' inside an archive into buffer and returns its size,
+// returns -1 if the archive can't be opened, the password is wrong, the file is not there, it is larger than capacity
+// or the archive is corrupted
+inline long int read_entry(const char *archive_path,const std::string &path,unsigned char *buffer,long int capacity,
+                        const std::string &password=""){
+    corruption_guard guard(decode_table::throw_corrupted);
+    try{
+        archive_reader archive;
+        archive_entry entry;
+        if(!archive.open(archive_path)||archive.password!=password)return -1;
+        if(!archive.find(path,entry)||!entry.is_file||entry.size>capacity)return -1;
+        archive.read(buffer,entry.size);
+        return entry.size;
+    }
+    catch(corrupted_data&){
+        return -1;
+    }
+}
+
+// decodes the file at 'path' inside an archive into output_path, which is created with the final size and
+// mapped into memory, so the blocks are decoded straight into the page cache instead of going through stdio
+    // returns false if the archive can't be opened, the password is wrong, the file is not there, output_path can't be
+    // written or the archive is corrupted (output_path is removed then)
+inline bool extract_entry_to_file(const char *archive_path,const std::string &path,const char *output_path,
+                        const std::string &password=""){
+    corruption_guard guard(decode_table::throw_corrupted);
+    int fd=-1;
+    void *map=MAP_FAILED;
+    archive_entry entry;
+    try{
+        archive_reader archive;
+        if(!archive.open(archive_path)||archive.password!=password)return false;
+        if(!archive.find(path,entry)||!entry.is_file)return false;
+        fd=::open(output_path,O_RDWR|O_CREAT|O_TRUNC,0644);
+        if(fd<0)return false;
+        if(entry.size==0){
+            ::close(fd);
+            return true;
+        }
+        if(ftruncate(fd,entry.size)==0){
+            map=mmap(NULL,entry.size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+        }
+        if(map==MAP_FAILED){
+            ::close(fd);
+            unlink(output_path);
+            return false;
+        }
+        archive.read((unsigned char*)map,entry.size);
+    }
+    catch(corrupted_data&){
+        if(map!=MAP_FAILED)munmap(map,entry.size);
+        if(fd>=0){
+            ::close(fd);
+            unlink(output_path);
+        }
+        return false;
+    }
+    munmap(map,entry.size);
+    ::close(fd);
+    return true;
+}
+
+#endif
@@ -0,0 +1,302 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <omp.h>
+#include "huffman.hpp"
+#include "block_format.hpp"
+#include "block_decoder.hpp"
+
+// In-process benchmark of the codec: encode and decode speed, ratio and thread scaling on generated inputs
+// usage: ./bench [size_in_MiB] [repetitions] [max_threads]
+//   blocks:  huffman_encode / huffman_decode of libhuffman (the blocks of --blocks archives, a table every 256 KiB)
+//   single:  one table for the whole input, the way version 1 archives translate their content
+//   4streams: the blocks of --interleave archives, each one split into 4 streams that are decoded side by side
+// Speeds are in MB/s of original bytes, p50 is the median run and p90 the slowest 10% (nearest rank).
+
+typedef std::vector<unsigned char> buffer;
+
+struct corpus
+{
+  std::string name;
+  std::vector<buffer> files; // every file is encoded and decoded on its own
+  size_t size = 0;
+};
+
+struct codec
+{
+  const char *name;
+  void (*encode)(const buffer &, buffer &);
+  void (*decode)(const buffer &, buffer &);
+};
+
+void blocks_encode(const buffer &in, buffer &out)
+{
+  vector_sink sink;
+  huffman_encode(in.data(), in.size(), sink);
+  out.swap(sink.data);
+}
+
+void blocks_decode(const buffer &in, buffer &out)
+{
+  vector_sink sink;
+  sink.data.reserve(std::max(0LL, huffman_decoded_size(in.data(), in.size())));
+  if (!huffman_decode(in.data(), in.size(), sink))
+    sink.data.clear();
+  out.swap(sink.data);
+}
+
+// 8 bytes of length, the code lengths of block_format.hpp and the whole input translated with that table
+void single_encode(const buffer &in, buffer &out)
+{
+  long int number[256] = {0};
+  int length[256];
+  count_bytes(in.data(), in.size(), number);
+  huffman_code_lengths(number, length);
+  code_table table;
+  canonical_codes(length, table);
+  bit_writer writer(NULL, in.size() / 2 + 1024);
+  write_number(in.size(), 8, writer);
+  if (in.size())
+    write_code_lengths(length, writer);
+  for (size_t i = 0; i < in.size(); i++)
+    writer.write_symbol(table, in[i]);
+  writer.finish();
+  out.assign(writer.buffer.begin(), writer.buffer.begin() + writer.used);
+}
+
+void single_decode(const buffer &in, buffer &out)
+{
+  bit_reader reader(in.data(), in.size());
+  long int n = read_number(reader, 8);
+  out.resize(n);
+  if (!n)
+    return;
+  decode_table table;
+  read_code_lengths(reader, table);
+  table.decode(reader, out.data(), n);
+}
+
+// 8 bytes of length and 256 KiB blocks with 4 streams each (mode 4 of block_format.hpp)
+void streams_encode(const buffer &in, buffer &out)
+{
+  bit_writer writer(NULL, in.size() + in.size() / 64 + 1024);
+  write_number(in.size(), 8, writer);
+  for (size_t i = 0; i < in.size(); i += default_block_size)
+    encode_block(in.data() + i, std::min((size_t)default_block_size, in.size() - i), writer, default_max_code_length, true);
+  writer.finish();
+  out.assign(writer.buffer.begin(), writer.buffer.begin() + writer.used);
+}
+
+void streams_decode(const buffer &in, buffer &out)
+{
+  bit_reader reader(in.data(), in.size());
+  long int n = read_number(reader, 8);
+  out.resize(n);
+  decode_table table;
+  for (long int done = 0; done < n;)
+  {
+    int mode;
+    long int m = read_block_header(reader, mode, n - done);
+    decode_block_body(reader, table, mode, m, out.data() + done);
+    done += m;
+  }
+}
+
+// inputs are generated with a fixed seed, so every run benchmarks the same bytes
+void fill_uniform(buffer &data, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    data.push_back(rand() & 255);
+}
+
+void fill_skewed(buffer &data, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    data.push_back(rand() % 10 ? 'a' : rand() & 255);
+}
+
+void fill_text(buffer &data, size_t n)
+{
+  static const char *words[] = {"the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with",
+                                "be", "by", "on", "not", "he", "this", "are", "or", "his", "from", "at", "which",
+                                "but", "have", "an", "had", "they", "you", "were", "their", "one", "all", "we",
+                                "compression", "huffman", "archive", "frequency", "table", "block", "Decoder"};
+  const int count = sizeof(words) / sizeof(words[0]);
+  while (data.size() < n)
+  {
+    int r = rand() % count;
+    const char *w = words[rand() % 3 ? r % 12 : r]; // the first words are used more often
+    data.insert(data.end(), w, w + strlen(w));
+    data.push_back(rand() % 12 ? ' ' : '\n');
+  }
+  data.resize(n);
+}
+
+std::vector<corpus> make_corpora(size_t size)
+{
+  std::vector<corpus> corpora(5);
+  srand(1);
+  corpora[0].name = "uniform random";
+  corpora[0].files.resize(1);
+  fill_uniform(corpora[0].files[0], size);
+  corpora[1].name = "text";
+  corpora[1].files.resize(1);
+  fill_text(corpora[1].files[0], size);
+  corpora[2].name = "skewed (90% one byte)";
+  corpora[2].files.resize(1);
+  fill_skewed(corpora[2].files[0], size);
+  corpora[3].name = "small files (0-8 KiB)";
+  for (size_t total = 0; total < size;)
+  {
+    corpora[3].files.push_back(buffer());
+    fill_text(corpora[3].files.back(), rand() % 8193);
+    total += corpora[3].files.back().size();
+  }
+  corpora[4].name = "one huge file";
+  corpora[4].files.resize(1);
+  fill_text(corpora[4].files[0], 8 * size);
+  for (size_t c = 0; c < corpora.size(); c++)
+    for (size_t f = 0; f < corpora[c].files.size(); f++)
+      corpora[c].size += corpora[c].files[f].size();
+  return corpora;
+}
+
+// the run time at percentile p (nearest rank) turned into MB/s
+double speed_at(std::vector<double> seconds, double p, size_t bytes)
+{
+  std::sort(seconds.begin(), seconds.end());
+  size_t rank = (size_t)(p / 100 * seconds.size() + 0.999999);
+  rank = std::max((size_t)1, std::min(rank, seconds.size()));
+  return bytes / seconds[rank - 1] / 1e6;
+}
+
+double now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// encodes and decodes every file of the corpus 'repetitions' times, returns false if a file did not come back
+bool measure(const codec &c, const corpus &input, int repetitions)
+{
+  std::vector<buffer> encoded(input.files.size()), decoded(input.files.size());
+  std::vector<double> encode_times, decode_times;
+  size_t compressed = 0;
+  for (int r = 0; r < repetitions; r++)
+  {
+    double start = now();
+    for (size_t f = 0; f < input.files.size(); f++)
+      c.encode(input.files[f], encoded[f]);
+    double middle = now();
+    for (size_t f = 0; f < input.files.size(); f++)
+      c.decode(encoded[f], decoded[f]);
+    double end = now();
+    encode_times.push_back(middle - start);
+    decode_times.push_back(end - middle);
+  }
+  for (size_t f = 0; f < input.files.size(); f++)
+  {
+    if (decoded[f] != input.files[f])
+    {
+      std::cerr << c.name << " did not decode " << input.name << " correctly" << std::endl;
+      return false;
+    }
+    compressed += encoded[f].size();
+  }
+  std::cout << std::left << std::setw(24) << input.name << std::setw(10) << c.name
+            << std::right << std::fixed << std::setprecision(1) << std::setw(10) << input.size / 1048576.0
+            << std::setprecision(2) << std::setw(9) << 100.0 * compressed / input.size << '%'
+            << std::setprecision(1)
+            << std::setw(11) << speed_at(encode_times, 50, input.size)
+            << std::setw(11) << speed_at(encode_times, 90, input.size)
+            << std::setw(11) << speed_at(decode_times, 50, input.size)
+            << std::setw(11) << speed_at(decode_times, 90, input.size) << std::endl;
+  return true;
+}
+
+// the file is cut into 4 MiB segments that threads encode (and decode) independently,
+// like modified_archive and extract do with the files of an archive (1, 2, 4, ... and max_threads threads)
+bool scaling(const corpus &input, int repetitions, int max_threads)
+{
+  const buffer &data = input.files[0];
+  const size_t segment = 4 << 20;
+  long int segments = (data.size() + segment - 1) / segment;
+  std::vector<buffer> pieces(segments), encoded(segments), decoded(segments);
+  for (long int s = 0; s < segments; s++)
+    pieces[s].assign(data.begin() + s * segment, data.begin() + std::min(data.size(), (s + 1) * segment));
+
+  std::cout << "\nThread scaling on " << input.name << " (" << segments << " segments of 4 MiB, blocks, p50 MB/s)\n"
+            << std::setw(8) << "threads" << std::setw(11) << "encode" << std::setw(9) << "speedup"
+            << std::setw(11) << "decode" << std::setw(9) << "speedup" << std::endl;
+  std::vector<int> counts;
+  for (int threads = 1; threads < max_threads; threads *= 2)
+    counts.push_back(threads);
+  counts.push_back(max_threads);
+  double encode_base = 0, decode_base = 0;
+  for (size_t i = 0; i < counts.size(); i++)
+  {
+    int threads = counts[i];
+    std::vector<double> encode_times, decode_times;
+    for (int r = 0; r < repetitions; r++)
+    {
+      double start = now();
+#pragma omp parallel for num_threads(threads) schedule(dynamic)
+      for (long int s = 0; s < segments; s++)
+        blocks_encode(pieces[s], encoded[s]);
+      double middle = now();
+#pragma omp parallel for num_threads(threads) schedule(dynamic)
+      for (long int s = 0; s < segments; s++)
+        blocks_decode(encoded[s], decoded[s]);
+      double end = now();
+      encode_times.push_back(middle - start);
+      decode_times.push_back(end - middle);
+    }
+    if (decoded != pieces)
+    {
+      std::cerr << "blocks did not decode the segments correctly with " << threads << " threads" << std::endl;
+      return false;
+    }
+    double encode = speed_at(encode_times, 50, data.size()), decode = speed_at(decode_times, 50, data.size());
+    if (threads == 1)
+    {
+      encode_base = encode;
+      decode_base = decode;
+    }
+    std::cout << std::setw(8) << threads << std::fixed << std::setprecision(1)
+              << std::setw(11) << encode << std::setprecision(2) << std::setw(8) << encode / encode_base << 'x'
+              << std::setprecision(1) << std::setw(11) << decode << std::setprecision(2) << std::setw(8) << decode / decode_base << 'x' << std::endl;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  size_t size = (argc > 1 ? atol(argv[1]) : 16) << 20;
+  int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+  int max_threads = argc > 3 ? atoi(argv[3]) : omp_get_max_threads();
+  if (size == 0 || repetitions < 1 || max_threads < 1)
+  {
+    std::cerr << "usage: " << argv[0] << " [size_in_MiB] [repetitions] [max_threads]" << std::endl;
+    return 1;
+  }
+
+  std::vector<corpus> corpora = make_corpora(size);
+  codec codecs[] = {{"blocks", blocks_encode, blocks_decode}, {"single", single_encode, single_decode},
+                     {"4streams", streams_encode, streams_decode}};
+
+  std::cout << "Codec on generated inputs, " << repetitions << " runs each (MB/s)\n"
+            << std::left << std::setw(24) << "Input" << std::setw(10) << "codec"
+            << std::right << std::setw(10) << "MiB" << std::setw(10) << "ratio"
+            << std::setw(11) << "enc p50" << std::setw(11) << "enc p90"
+            << std::setw(11) << "dec p50" << std::setw(11) << "dec p90" << std::endl;
+  for (size_t c = 0; c < corpora.size(); c++)
+    for (size_t k = 0; k < sizeof(codecs) / sizeof(codecs[0]); k++)
+      if (!measure(codecs[k], corpora[c], repetitions))
+        return 1;
+
+  return scaling(corpora.back(), repetitions, max_threads) ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+#ifndef BIT_READER_HPP
+#define BIT_READER_HPP
+
+#include<cstdio>
+#include<cstring>
+#include<vector>
+
+struct bit_reader{
+    // this struct reads the compressed file as one continuous stream of bits (most significant bit first)
+    // It keeps up to 64 bits left aligned in 'bits' so the decoder can look at
+    // the next 56 bits without touching the file, and reads the file itself in large chunks.
+    // It can also read compressed data that is already in memory (fp is NULL then and the data is the only chunk).
+    FILE *fp;
+    std::vector<unsigned char> chunk;
+    const unsigned char *next=NULL,*end=NULL;
+    unsigned long long bits=0;
+    int count=0;                    // number of valid bits inside 'bits'
+    long int chunk_start;           // file offset of chunk[0]
+    long int overrun=0;             // zero bytes that were given out after the end of the file
+
+    const unsigned char *memory=NULL,*memory_end=NULL;
+
+    explicit bit_reader(FILE *f,size_t chunk_size=1<<16):fp(f),chunk(chunk_size){
+        chunk_start=ftell(fp);
+        next=end=&chunk[0];
+    }
+
+    bit_reader(const unsigned char *data,size_t n):fp(NULL),memory(data),memory_end(data+n){
+        chunk_start=0;
+        next=data;
+        end=data+n;
+    }
+
+    // start of the current chunk
+    const unsigned char *chunk_begin(){
+        return memory?memory:&chunk[0];
+    }
+
+    bool fill_chunk(){
+        if(!fp){
+            chunk_start+=end-memory;
+            next=end=memory;
+            return false;
+        }
+        chunk_start+=end-&chunk[0];
+        size_t got=fread(&chunk[0],1,chunk.size(),fp);
+        next=&chunk[0];
+        end=next+got;
+        return got;
+    }
+
+    // tops 'bits' up to at least 57 valid bits
+        // past the end of the file it keeps feeding zeros, the callers know how many bits they need
+    void refill(){
+        if(count>56)return;
+        if(end-next>=8){
+            unsigned long long word=0;
+            for(int i=0;i<8;i++)word=word<<8|next[i];
+            int take=(64-count)>>3;
+            if(take<8)word>>=64-8*take;
+            bits|=word<<(64-count-8*take);
+            count+=8*take;
+            next+=take;
+            return;
+        }
+        while(count<=56){
+            if(next==end&&!fill_chunk()){
+                overrun++;
+                count+=8;
+                continue;
+            }
+            bits|=(unsigned long long)*next++<<(56-count);
+            count+=8;
+        }
+    }
+
+    unsigned int peek(int n){       // 1<=n<=56, refill() has to be called before
+        return bits>>(64-n);
+    }
+    void consume(int n){
+        bits<<=n;
+        count-=n;
+    }
+    unsigned int read_bits(int n){  // 1<=n<=32
+        if(count<n)refill();
+        unsigned int val=peek(n);
+        consume(n);
+        return val;
+    }
+
+    // skips the rest of the current byte
+    void align(){
+        consume(count&7);
+    }
+
+    // copies n bytes to dst, the reader has to be on a byte boundary
+        // large copies bypass the chunk and are read straight into dst
+    void read_bytes(unsigned char *dst,long int n){
+        while(count>=8&&n){
+            *dst++=read_bits(8);
+            n--;
+        }
+        long int m=end-next;
+        if(m>n)m=n;
+        memcpy(dst,next,m);
+        next+=m;
+        dst+=m;
+        n-=m;
+        if(n&&!fp){
+            memset(dst,0,n);
+            overrun+=n;
+        }
+        else if(n){
+            chunk_start+=end-&chunk[0];
+            next=end=&chunk[0];
+            long int got=fread(dst,1,n,fp);
+            chunk_start+=got;
+            if(got<n){
+                memset(dst+got,0,n-got);
+                overrun+=n-got;
+            }
+        }
+    }
+
+    // offset of the next unread byte in the compressed file
+    long int position(){
+        return chunk_start+(next-chunk_begin())-count/8+overrun;
+    }
+
+    // continues reading from the given offset of the compressed file
+    void seek(long int offset){
+        if(!fp){
+            chunk_start=0;
+            next=offset<memory_end-memory?memory+offset:memory_end;
+            end=memory_end;
+            bits=0;
+            count=0;
+            overrun=0;
+            return;
+        }
+        fseek(fp,offset,SEEK_SET);
+        chunk_start=offset;
+        next=end=&chunk[0];
+        bits=0;
+        count=0;
+        overrun=0;
+    }
+};
+
+#endif
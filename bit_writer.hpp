@@ -0,0 +1,165 @@
+#ifndef BIT_WRITER_HPP
+#define BIT_WRITER_HPP
+
+#include<cstdio>
+#include<cstring>
+#include<algorithm>
+#include<vector>
+
+struct code_table{
+    // integer version of the transformation strings
+    // code[x] holds the last (up to 64) bits of x's transformation right aligned and
+    // code_high[x] holds the bits before them, which only codes longer than 64 bits need
+    unsigned long long code[256],code_high[256];
+    int length[256];
+
+    code_table(){
+        memset(code,0,sizeof(code));
+        memset(code_high,0,sizeof(code_high));
+        memset(length,0,sizeof(length));
+    }
+};
+
+struct bit_writer{
+    // collects bits inside a 64 bit accumulator and moves them to 'buffer' 32 bits at a time
+    // if fp is set, buffer is written to the file whenever it is full,
+    // otherwise buffer keeps growing and holds everything that has been written (used for in-memory outputs)
+    FILE *fp;
+    std::vector<unsigned char> buffer;
+    size_t used=0;
+    unsigned long long accumulator=0;
+    int count=0;                // bits waiting inside the accumulator, always less than 32 between calls
+    long int flushed=0;         // bytes that are already written to fp
+    std::vector<long int> marks;    // bit positions that are recorded with mark(), append() keeps them
+
+    explicit bit_writer(FILE *f=NULL,size_t buffer_size=1<<20):fp(f),buffer(buffer_size){}
+
+    void flush(){
+        if(fp&&used){
+            fwrite(&buffer[0],1,used,fp);
+            flushed+=used;
+            used=0;
+        }
+    }
+
+    void put_word(unsigned int word){
+        if(used+4>buffer.size()){
+            if(fp)flush();
+            else buffer.resize(2*buffer.size()+4);
+        }
+        unsigned char *p=&buffer[used];
+        p[0]=word>>24;
+        p[1]=word>>16;
+        p[2]=word>>8;
+        p[3]=word;
+        used+=4;
+    }
+
+    // writes the last 'length' bits of value, most significant one first (length<=64)
+    void write(unsigned long long value,int length){
+        if(length>32){
+            write(value>>32,length-32);
+            length=32;
+        }
+        if(length<64)value&=(1ULL<<length)-1;
+        accumulator=accumulator<<length|value;
+        count+=length;
+        if(count>=32){
+            count-=32;
+            put_word(accumulator>>count);
+        }
+    }
+
+    void write_byte(unsigned char uChar){
+        write(uChar,8);
+    }
+
+    void write_symbol(const code_table &table,unsigned char x){
+        if(table.length[x]<=64){
+            write(table.code[x],table.length[x]);
+        }
+        else{
+            write(table.code_high[x],table.length[x]-64);
+            write(table.code[x],64);
+        }
+    }
+
+    // appends everything that has been written to another (in-memory) writer
+        // used for stitching outputs that were created in parallel, they don't have to end on a byte boundary
+    void append(const bit_writer &other){
+        long int base=bit_count();
+        for(size_t i=0;i<other.marks.size();i++){
+            marks.push_back(base+other.marks[i]);
+        }
+        size_t i=0;
+        if(count%8==0){     // no shifting needed, the bytes are copied as they are
+            for(;count;count-=8){
+                write_tail(accumulator>>(count-8));
+            }
+            while(i<other.used){
+                if(used==buffer.size()){
+                    if(fp)flush();
+                    else buffer.resize(2*buffer.size()+1);
+                }
+                size_t n=std::min(other.used-i,buffer.size()-used);
+                memcpy(&buffer[used],&other.buffer[i],n);
+                used+=n;
+                i+=n;
+            }
+        }
+        for(;i+4<=other.used;i+=4){
+            const unsigned char *p=&other.buffer[i];
+            write((unsigned int)p[0]<<24|p[1]<<16|p[2]<<8|p[3],32);
+        }
+        for(;i<other.used;i++){
+            write(other.buffer[i],8);
+        }
+        write(other.accumulator,other.count);
+    }
+
+    // writes zero bits up to the next byte boundary
+    void align(){
+        write(0,(8-count%8)%8);
+    }
+
+    long int bit_count(){
+        return (flushed+used)*8+count;
+    }
+
+    // empties the writer so that it can be used again (keeps the buffer)
+    void clear(){
+        used=0;
+        accumulator=0;
+        count=0;
+        flushed=0;
+        marks.clear();
+    }
+
+    // remembers the current position (used for the central directory of version 2 archives)
+    void mark(){
+        marks.push_back(bit_count());
+    }
+
+    // fills the last byte with zeros and writes everything to fp
+    void finish(){
+        while(count>=8){
+            count-=8;
+            write_tail(accumulator>>count);
+        }
+        if(count){
+            write_tail(accumulator<<(8-count));
+            count=0;
+        }
+        flush();
+    }
+
+    void write_tail(unsigned char uChar){
+        if(used==buffer.size()){
+            if(fp)flush();
+            else buffer.resize(2*buffer.size()+1);
+        }
+        buffer[used++]=uChar;
+    }
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef BLOCK_DECODER_HPP
+#define BLOCK_DECODER_HPP
+
+#include<algorithm>
+#include<cstring>
+#include<vector>
+#include "bit_reader.hpp"
+#include "decode_table.hpp"
+#include "block_format.hpp"
+
+// Decoding side of block_format.hpp, used by extract and by the library (huffman.cpp)
+
+
+
+// reads a number that was written from least significant byte to most significant byte
+inline long int read_number(bit_reader &in,int bytes){
+    long int val=0;
+    for(int i=0;i<bytes;i++){
+        val|=(long int)in.read_bits(8)<<(8*i);
+    }
+    return val;
+}
+
+
+
+// reads the code lengths of a canonical table (a huffman block's or the name table of a version 2 archive),
+// assigns the same canonical codes the compressor did and builds the decode table from them
+inline void read_code_lengths(bit_reader &in,decode_table &table){
+    int length[256]={0};
+    int used=in.read_bits(8)+1;
+    if(used<32){
+        for(int i=0;i<used;i++){
+            length[in.read_bits(8)]=-1;
+        }
+    }
+    else{
+        for(int i=0;i<32;i++){
+            unsigned char bitmap=in.read_bits(8);
+            for(int j=0;j<8;j++){
+                if(bitmap&(128>>j)){
+                    length[8*i+j]=-1;
+                    used--;
+                }
+            }
+        }
+        if(used)decode_table::corrupted();
+    }
+    for(int i=0;i<256;i++){
+        if(length[i]){
+            length[i]=in.read_bits(8);
+            if(length[i]==0||length[i]>64)decode_table::corrupted();
+        }
+    }
+    code_table codes;
+    canonical_codes(length,codes);
+    table.build(codes.length,codes.code);
+}
+
+
+
+// reads the mode and the original length of the next block and returns the length
+    // the block can't be longer than 'remaining', the reader has to be on a byte boundary
+inline long int read_block_header(bit_reader &in,int &mode,long int remaining){
+    mode=in.read_bits(8);
+    long int n=read_number(in,4);
+    if(n<=0||n>remaining||n>max_block_size)decode_table::corrupted();
+    return n;
+}
+
+// decodes the rest of an interleaved block (mode 4): the 4 streams are decoded side by side
+    // streams of memory readers are decoded where they are, the ones of a file are read into table.streams first
+inline void decode_streams(bit_reader &in,decode_table &table,long int n,unsigned char *out){
+    read_code_lengths(in,table);
+    long int payload=read_number(in,4);
+    if(payload<12||payload>8*n+12)decode_table::corrupted();
+    long int size[4],total=payload-12;
+    for(int k=0;k<3;k++){
+        size[k]=read_number(in,4);
+        total-=size[k];
+        if(size[k]<0||total<0)decode_table::corrupted();
+    }
+    size[3]=total;
+    const unsigned char *data;
+    long int start=in.position();
+    if(!in.fp&&start+payload-12<=in.memory_end-in.memory){
+        data=in.memory+start;
+        in.seek(start+payload-12);
+    }
+    else{
+        table.streams.resize(payload-12);
+        in.read_bytes(table.streams.data(),payload-12);
+        data=table.streams.data();
+    }
+    long int quarter=(n+3)/4;
+    bit_reader streams[4]={bit_reader(data,size[0]),bit_reader(data+size[0],size[1]),
+                           bit_reader(data+size[0]+size[1],size[2]),bit_reader(data+size[0]+size[1]+size[2],size[3])};
+    unsigned char *next[4],*stop[4];
+    for(int k=0;k<4;k++){
+        next[k]=out+std::min(n,k*quarter);
+        stop[k]=out+std::min(n,(k+1)*quarter);
+    }
+    table.decode4(streams,next,stop);
+    for(int k=0;k<4;k++){
+        streams[k].align();
+        if(streams[k].position()!=size[k])decode_table::corrupted();
+    }
+}
+
+// decodes the rest of a block whose header was just read into out (n bytes)
+inline void decode_block_body(bit_reader &in,decode_table &table,int mode,long int n,unsigned char *out){
+    switch(mode){
+        case BLOCK_STORED:
+        in.read_bytes(out,n);
+        break;
+        case BLOCK_SINGLE:
+        memset(out,in.read_bits(8),n);
+        break;
+        case BLOCK_HUFFMAN:{
+            read_code_lengths(in,table);
+            long int payload=read_number(in,4);
+            long int start=in.position();
+            table.decode(in,out,n);
+            in.align();
+            if(in.position()!=start+payload)decode_table::corrupted();
+        }
+        break;
+        case BLOCK_HUFFMAN4:
+        decode_streams(in,table,n,out);
+        break;
+        default:
+        decode_table::corrupted();
+    }
+}
+
+// decodes the next block into block (resized if needed) and returns its length
+inline long int decode_block(bit_reader &in,decode_table &table,std::vector<unsigned char> &block,long int remaining){
+    int mode;
+    long int n=read_block_header(in,mode,remaining);
+    if((long int)block.size()<n)block.resize(n);
+    decode_block_body(in,table,mode,n,&block[0]);
+    return n;
+}
+
+// moves the reader past the rest of a block whose header was just read without decoding it
+inline void skip_block_body(bit_reader &in,int mode,long int n){
+    switch(mode){
+        case BLOCK_STORED:
+        in.seek(in.position()+n);
+        break;
+        case BLOCK_SINGLE:
+        in.read_bits(8);
+        break;
+        case BLOCK_HUFFMAN:
+        case BLOCK_HUFFMAN4:{
+            int used=in.read_bits(8)+1;
+            in.seek(in.position()+code_lengths_size(used)-1);
+            long int payload=read_number(in,4);
+            in.seek(in.position()+payload);
+        }
+        break;
+        default:
+        decode_table::corrupted();
+    }
+}
+
+#endif
@@ -0,0 +1,433 @@
+#ifndef BLOCK_FORMAT_HPP
+#define BLOCK_FORMAT_HPP
+
+#include<algorithm>
+#include<vector>
+#include<deque>
+#include<string>
+#include "bit_writer.hpp"
+#include "input_file.hpp"
+#include "histogram.hpp"
+#include "checksum.hpp"
+
+/*          BLOCK FORMAT (archive version 2)
+    Version 1 archives translate everything with one table that is written in the third section.
+    Version 2 archives keep the same folder structure but split the content of every file into blocks,
+    and every block carries its own canonical translation table, so it adapts to the data inside it
+    and can be encoded and decoded independently of the other blocks.
+
+first (5 bytes)             ->  0xFF 0xFF 'H' 'F' version
+                                (a version 1 archive can never start with 0xFF 0xFF, its second byte is the password length)
+second                      ->  same as version 1
+third                       ->  code lengths of the canonical table that translates file and folder names
+fourth                      ->  same as version 1
+fifth                       ->  zero bits up to the next byte boundary, then the same as version 1
+                                (every file or folder starts on a byte boundary, so the part of the archive that belongs
+                                to it can be written on its own and put after the others without shifting)
+sixth - seventh             ->  same as version 1
+eighth (IF FILE)            ->  zero bits up to the next byte boundary, then the blocks of the file
+central directory           ->  after the last file or folder, starting on a byte boundary
+    for each file or folder (in the order they are written):
+        8 bytes             ->  offset of its fifth section
+        8 bytes             ->  original size (0 for folders)
+        4 bytes             ->  CRC-32 of the content (0 for folders, see checksum.hpp)
+        1 byte              ->  1 for files, 0 for folders
+        2 bytes             ->  length of the path
+        path                ->  "folder/file" the way it is given to the compressor, not translated
+    8 bytes                 ->  number of files and folders
+    8 bytes                 ->  offset of the central directory
+    4 bytes                 ->  'H' 'F' 'C' 'D'
+    (the extractor uses it to find where the content of every file starts and ends without decoding
+    the files before it, so files can be decoded at the same time, single files can be extracted
+    without reading the others and the archive can be listed without decoding anything.
+    Archives without it are read in order)
+
+block (whole bytes)
+    1 byte                  ->  mode
+    4 bytes                 ->  original length of the block
+    mode 0 (stored)         ->  original bytes
+    mode 1 (huffman)        ->  code lengths of the block's canonical table
+                                4 bytes: length of the translated block in bytes
+                                translated block (canonical codes, zero bits up to the next byte boundary)
+    mode 2 (single byte)    ->  1 byte: the byte that fills the whole block
+    mode 3 (end)            ->  nothing else, only ends memory streams whose length was not known
+    mode 4 (huffman, 4 streams, --interleave)
+                            ->  code lengths of the block's canonical table
+                                4 bytes: length of everything below in bytes
+                                3 x 4 bytes: lengths of the first three streams in bytes
+                                4 streams: the translated quarters of the block, each one ending on a byte boundary
+                                (the first three quarters hold (length+3)/4 bytes, the last one the rest)
+                                The decoder runs four bit readers side by side, which is faster on a single core
+                                because their lookups don't wait for each other (extract of earlier versions
+                                does not know this mode)
+
+code lengths (whole bytes)
+    1 byte                  ->  number of used bytes - 1
+    used bytes              ->  if less than 32 bytes are used: the used bytes in increasing order
+                                otherwise 32 bytes: bitmap of used bytes (bit 7 of the first byte is byte 0)
+    1 byte for each used byte (in increasing order): code length
+    codes are not stored, both sides assign canonical codes from the lengths (see canonical_codes)
+
+memory streams (libhuffman, see huffman.hpp)
+    4 bytes                 ->  'H' 'F' 'S' version
+    8 bytes                 ->  original length (all ones if it was not known when the stream was written)
+    blocks                  ->  the same as the blocks of a file, followed by an end block if the length is not known
+
+all multi byte numbers are written from least significant byte to most significant byte
+*/
+
+const unsigned char archive_magic[4]={0xFF,0xFF,'H','F'};
+const unsigned char central_directory_magic[4]={'H','F','C','D'};
+const unsigned char stream_magic[3]={'H','F','S'};
+const size_t stream_header_size=12;
+const int central_directory_trailer_size=20;   // count, offset and magic at the end of the central directory
+const int block_format_version=2;
+const long int default_block_size=1<<18;
+const long int max_block_size=1<<24;
+const int default_max_code_length=15;   // codes are never longer than this, so decode tables stay small
+const int min_code_length_limit=8;      // 256 different bytes need 8 bits
+const int max_code_length_limit=32;
+
+const long int min_interleaved_block=1<<12;     // smaller blocks are not split into 4 streams
+
+enum block_mode{BLOCK_STORED=0,BLOCK_HUFFMAN=1,BLOCK_SINGLE=2,BLOCK_END=3,BLOCK_HUFFMAN4=4};
+
+
+
+// limits code lengths to max_length bits with the package-merge algorithm
+    // symbols[0..n) are sorted by increasing weight. Every level merges the leaves with the pairs (packages)
+    // of the previous level's list, and the code length of a symbol is how many times its leaf is inside
+    // the first 2n-2 items of the last list
+inline void package_merge(const long int *number,const int *symbols,int n,int max_length,int *length){
+    struct item{
+        long int weight;
+        int leaf;           // index inside symbols for leaves, -1 for packages
+        int left,right;     // the two items of a package (inside pool)
+    };
+    std::vector<item> pool;
+    std::vector<int> previous,current;
+    for(int level=0;level<max_length;level++){
+        std::vector<int> packages;
+        for(size_t i=0;i+1<previous.size();i+=2){
+            item package={pool[previous[i]].weight+pool[previous[i+1]].weight,-1,previous[i],previous[i+1]};
+            packages.push_back(pool.size());
+            pool.push_back(package);
+        }
+        current.clear();
+        size_t p=0;
+        for(int i=0;i<n||p<packages.size();){
+            if(i<n&&(p>=packages.size()||number[symbols[i]]<=pool[packages[p]].weight)){
+                item leaf={number[symbols[i]],i,0,0};
+                current.push_back(pool.size());
+                pool.push_back(leaf);
+                i++;
+            }
+            else{
+                current.push_back(packages[p++]);
+            }
+        }
+        previous.swap(current);
+    }
+    for(int i=0;i<n;i++)length[symbols[i]]=0;
+    std::vector<int> stack(previous.begin(),previous.begin()+2*n-2);
+    while(!stack.empty()){
+        item it=pool[stack.back()];
+        stack.pop_back();
+        if(it.leaf>=0){
+            length[symbols[it.leaf]]++;
+        }
+        else{
+            stack.push_back(it.left);
+            stack.push_back(it.right);
+        }
+    }
+}
+
+
+
+// the Huffman tree of the used bytes in a flat pool: leaves 0..n-1 are the symbols, nodes n..2n-2 the merges (2n-2 is the root)
+struct huffman_pool{
+    int symbols[256],n=0;       // the used bytes by increasing weight
+    long int weight[511];
+    int parent[511],depth[511];
+    unsigned char bit[511];     // 1 for the first of the two children that were merged, 0 for the second
+    int longest=0;              // depth of the deepest leaf
+};
+
+// builds the tree of the bytes that are used (number[x]!=0), which needs at least two of them
+    // Leaves are sorted with std::sort and merged with the two queue method the compressors always used
+    // (a leaf only wins against a node if it is lighter), so version 1 archives stay byte for byte the same.
+    // Every node only keeps its parent, and the depth of each leaf is found by walking from the root down once
+inline void build_huffman_pool(const long int *number,huffman_pool &pool){
+    int n=pool.n;
+    std::sort(pool.symbols,pool.symbols+n,[number](int a,int b){return number[a]<number[b];});
+    long int *weight=pool.weight;
+    for(int i=0;i<n;i++)weight[i]=number[pool.symbols[i]];
+    int first=0,second=1,leaf=2,node=n;
+    for(int current=n;;current++){
+        weight[current]=weight[first]+weight[second];
+        pool.parent[first]=pool.parent[second]=current;
+        pool.bit[first]=1;
+        pool.bit[second]=0;
+        if(current==2*n-2)break;
+        if(leaf<n&&weight[leaf]<weight[node])first=leaf++;
+        else first=node++;
+        if(leaf<n&&(node>current||weight[leaf]<weight[node]))second=leaf++;
+        else second=node++;
+    }
+    pool.depth[2*n-2]=0;
+    pool.longest=0;
+    for(int i=2*n-3;i>=0;i--){
+        pool.depth[i]=pool.depth[pool.parent[i]]+1;
+        if(pool.depth[i]>pool.longest)pool.longest=pool.depth[i];
+    }
+}
+
+// calculates Huffman code lengths for the bytes that are used (number[x]!=0), none of them longer than max_length
+    // the lengths are the depths of build_huffman_pool, only if that gives a code that is too long,
+    // they are calculated again with package_merge
+inline void huffman_code_lengths(const long int *number,int *length,int max_length=default_max_code_length){
+    huffman_pool pool;
+    for(int i=0;i<256;i++){
+        length[i]=0;
+        if(number[i])pool.symbols[pool.n++]=i;
+    }
+    if(pool.n==0)return;
+    if(pool.n==1){
+        length[pool.symbols[0]]=1;
+        return;
+    }
+    build_huffman_pool(number,pool);
+    if(pool.longest>max_length){
+        package_merge(number,pool.symbols,pool.n,max_length,length);
+        return;
+    }
+    for(int i=0;i<pool.n;i++)length[pool.symbols[i]]=pool.depth[i];
+}
+
+
+
+// assigns canonical codes: shorter codes come first, codes of the same length are given in increasing byte order
+inline void canonical_codes(const int *length,code_table &table){
+    long int length_count[257]={0};
+    unsigned long long next_code[257];
+    for(int i=0;i<256;i++)length_count[length[i]]++;
+    length_count[0]=0;
+    unsigned long long code=0;
+    for(int bits=1;bits<=256;bits++){
+        code=(code+length_count[bits-1])<<1;
+        next_code[bits]=code;
+    }
+    for(int i=0;i<256;i++){
+        table.length[i]=length[i];
+        table.code[i]=table.code_high[i]=0;
+        if(length[i])table.code[i]=next_code[length[i]]++;
+    }
+}
+
+
+
+// the translation tree of version 1 archives, its codes are written in the third section as they are
+struct huffman_tree{
+    int symbols[256],n=0;       // the used bytes in the order of the third section (increasing weight)
+    long int total=0;           // weight of the root
+    code_table table;
+};
+
+// builds the translation tree of version 1 archives with build_huffman_pool
+    // the codes follow the bits of the pool from the root down, so archives stay byte for byte the same.
+    // If a code is longer than max_length, canonical codes of limited length are used instead
+inline void huffman_tree_codes(const long int *number,huffman_tree &tree,int max_length=default_max_code_length){
+    huffman_pool pool;
+    tree.total=0;
+    for(int i=0;i<256;i++){
+        tree.table.length[i]=0;
+        tree.table.code[i]=tree.table.code_high[i]=0;
+        if(number[i])pool.symbols[pool.n++]=i;
+        tree.total+=number[i];
+    }
+    int n=tree.n=pool.n;
+    if(n<2){            // a single byte gets an empty code
+        std::copy(pool.symbols,pool.symbols+n,tree.symbols);
+        return;
+    }
+    build_huffman_pool(number,pool);
+    std::copy(pool.symbols,pool.symbols+n,tree.symbols);
+    if(pool.longest>max_length){
+        int length[256];
+        huffman_code_lengths(number,length,max_length);
+        canonical_codes(length,tree.table);
+        return;
+    }
+    unsigned long long code[511];
+    code[2*n-2]=0;
+    for(int i=2*n-3;i>=0;i--)code[i]=code[pool.parent[i]]<<1|pool.bit[i];
+    for(int i=0;i<n;i++){
+        tree.table.length[tree.symbols[i]]=pool.depth[i];
+        tree.table.code[tree.symbols[i]]=code[i];
+    }
+}
+
+
+
+inline void write_number(unsigned long long value,int bytes,bit_writer &writer){
+    for(int i=0;i<bytes;i++){
+        writer.write_byte(value&255);
+        value>>=8;
+    }
+}
+
+inline void write_archive_magic(bit_writer &writer){
+    for(int i=0;i<4;i++)writer.write_byte(archive_magic[i]);
+    writer.write_byte(block_format_version);
+}
+
+// a file or folder of the central directory
+struct directory_entry{
+    std::string path;
+    bool is_file;
+    long int size;
+    unsigned int checksum;
+    long int offset;            // only filled in by the reader, the writer takes the marks of the bit_writer
+};
+// a deque, so the compressors can keep pointers to the entries they are still filling in
+typedef std::deque<directory_entry> central_directory;
+
+// writes the central directory with the positions that were marked at the beginning of every file and folder
+inline void write_central_directory(bit_writer &writer,const central_directory &directory){
+    writer.align();
+    long int start=writer.bit_count()/8;
+    for(size_t i=0;i<writer.marks.size();i++){
+        const directory_entry &entry=directory[i];
+        write_number(writer.marks[i]/8,8,writer);
+        write_number(entry.size,8,writer);
+        write_number(entry.checksum,4,writer);
+        writer.write_byte(entry.is_file);
+        write_number(entry.path.size(),2,writer);
+        for(char c:entry.path)writer.write_byte(c);
+    }
+    write_number(writer.marks.size(),8,writer);
+    write_number(start,8,writer);
+    for(int i=0;i<4;i++)writer.write_byte(central_directory_magic[i]);
+}
+
+// returns how many bytes write_code_lengths uses for 'used' bytes
+inline long int code_lengths_size(int used){
+    return 1+(used<32?used:32)+used;
+}
+
+// writes the code lengths of a canonical table (at least one byte has to be used)
+inline void write_code_lengths(const int *length,bit_writer &writer){
+    int used=0;
+    for(int i=0;i<256;i++){
+        if(length[i])used++;
+    }
+    writer.write_byte(used-1);
+    if(used<32){
+        for(int i=0;i<256;i++){
+            if(length[i])writer.write_byte(i);
+        }
+    }
+    else{
+        for(int i=0;i<32;i++){
+            unsigned char bitmap=0;
+            for(int j=0;j<8;j++){
+                bitmap=bitmap<<1|(length[8*i+j]!=0);
+            }
+            writer.write_byte(bitmap);
+        }
+    }
+    for(int i=0;i<256;i++){
+        if(length[i])writer.write_byte(length[i]);
+    }
+}
+
+
+
+// writes one block (the writer has to be on a byte boundary, it is on a byte boundary afterwards too)
+    // with interleaved set, blocks that are translated are split into 4 streams (mode 4), their
+    // lengths come from the histograms of the quarters, which add up to the histogram of the block
+inline void encode_block(const unsigned char *data,long int n,bit_writer &writer,int max_length=default_max_code_length,
+                         bool interleaved=false){
+    long int number[256]={0},quarter_number[4][256]={{0}};
+    long int quarter=(n+3)/4;
+    interleaved=interleaved&&n>=min_interleaved_block;
+    if(interleaved){
+        for(int k=0;k<4;k++){
+            count_bytes(data+k*quarter,k<3?quarter:n-3*quarter,quarter_number[k]);
+            for(int i=0;i<256;i++)number[i]+=quarter_number[k][i];
+        }
+    }
+    else{
+        count_bytes(data,n,number);
+    }
+    int length[256],used=0;
+    huffman_code_lengths(number,length,max_length);
+    unsigned long long bits=0,quarter_bits[4]={0};
+    for(int i=0;i<256;i++){
+        if(length[i]){
+            used++;
+            bits+=(unsigned long long)number[i]*length[i];
+            for(int k=0;k<4;k++)quarter_bits[k]+=(unsigned long long)quarter_number[k][i]*length[i];
+        }
+    }
+    long int payload=(bits+7)/8;
+    if(interleaved){
+        payload=12;
+        for(int k=0;k<4;k++)payload+=(quarter_bits[k]+7)/8;
+    }
+
+    if(used==1){
+        writer.write_byte(BLOCK_SINGLE);
+        write_number(n,4,writer);
+        writer.write_byte(data[0]);
+    }
+    else if(code_lengths_size(used)+4+payload>=n){
+        writer.write_byte(BLOCK_STORED);
+        write_number(n,4,writer);
+        for(long int i=0;i<n;i++)writer.write_byte(data[i]);
+    }
+    else{
+        writer.write_byte(interleaved?BLOCK_HUFFMAN4:BLOCK_HUFFMAN);
+        write_number(n,4,writer);
+        write_code_lengths(length,writer);
+        write_number(payload,4,writer);
+        code_table table;
+        canonical_codes(length,table);
+        if(interleaved){
+            for(int k=0;k<3;k++)write_number((quarter_bits[k]+7)/8,4,writer);
+            for(int k=0;k<4;k++){
+                for(long int i=k*quarter;i<(k<3?(k+1)*quarter:n);i++){
+                    writer.write_symbol(table,data[i]);
+                }
+                writer.align();
+            }
+        }
+        else{
+            for(long int i=0;i<n;i++){
+                writer.write_symbol(table,data[i]);
+            }
+            writer.align();
+        }
+    }
+}
+
+
+
+// writes the eighth section of a version 2 archive: the whole file, block by block
+    // returns the CRC-32 of the file for the central directory, done (if given) is called with each block's length
+inline unsigned int write_file_blocks(input_file &input,long int block_size,bit_writer &writer,int max_length=default_max_code_length,
+                                      bool interleaved=false,void (*done)(long int)=NULL){
+    writer.align();
+    const unsigned char *data;
+    long int n;
+    unsigned int crc=0;
+    while((n=input.next(data,block_size))){
+        crc=crc32_update(crc,data,n);
+        encode_block(data,n,writer,max_length,interleaved);
+        if(done)done(n);
+    }
+    return crc;
+}
+
+#endif
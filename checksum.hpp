@@ -0,0 +1,79 @@
+#ifndef CHECKSUM_HPP
+#define CHECKSUM_HPP
+
+#include<cstdint>
+
+/*  CRC-32 (the one of zlib, gzip and zip) of file contents, used by the central directory (see block_format.hpp)
+    crc32_update works on 8 bytes at a time with 8 tables (slicing by 8),
+    crc32_combine joins the checksums of two pieces that were calculated separately (by different threads).
+*/
+
+struct crc32_tables{
+    uint32_t table[8][256];
+    crc32_tables(){
+        for(uint32_t i=0;i<256;i++){
+            uint32_t c=i;
+            for(int k=0;k<8;k++)c=c&1?0xEDB88320u^(c>>1):c>>1;
+            table[0][i]=c;
+        }
+        for(int t=1;t<8;t++){
+            for(int i=0;i<256;i++){
+                table[t][i]=table[0][table[t-1][i]&255]^(table[t-1][i]>>8);
+            }
+        }
+    }
+};
+
+// returns the checksum of everything before data (crc, 0 at the beginning) followed by n bytes of data
+inline uint32_t crc32_update(uint32_t crc,const unsigned char *data,long int n){
+    static const crc32_tables tables;
+    const uint32_t (*t)[256]=tables.table;
+    uint32_t c=~crc;
+    for(;n>=8;data+=8,n-=8){
+        uint32_t a=c^(data[0]|data[1]<<8|data[2]<<16|(uint32_t)data[3]<<24);
+        uint32_t b=data[4]|data[5]<<8|data[6]<<16|(uint32_t)data[7]<<24;
+        c=t[7][a&255]^t[6][(a>>8)&255]^t[5][(a>>16)&255]^t[4][a>>24]
+         ^t[3][b&255]^t[2][(b>>8)&255]^t[1][(b>>16)&255]^t[0][b>>24];
+    }
+    for(;n>0;n--){
+        c=t[0][(c^*data++)&255]^(c>>8);
+    }
+    return ~c;
+}
+
+// multiplies a 32x32 matrix over GF(2) with a vector
+inline uint32_t gf2_times(const uint32_t *matrix,uint32_t vector){
+    uint32_t sum=0;
+    for(;vector;vector>>=1,matrix++){
+        if(vector&1)sum^=*matrix;
+    }
+    return sum;
+}
+
+inline void gf2_square(uint32_t *square,const uint32_t *matrix){
+    for(int i=0;i<32;i++)square[i]=gf2_times(matrix,matrix[i]);
+}
+
+// returns the checksum of A followed by B from crc1 (of A), crc2 (of B) and the length of B
+    // crc1 is moved over length2 zero bytes by squaring the operator of a single zero bit (as zlib does)
+inline uint32_t crc32_combine(uint32_t crc1,uint32_t crc2,long int length2){
+    if(length2<=0)return crc1^crc2;
+    uint32_t even[32],odd[32];
+    odd[0]=0xEDB88320u;
+    for(int i=1;i<32;i++)odd[i]=1u<<(i-1);
+    gf2_square(even,odd);       // 2 zero bits
+    gf2_square(odd,even);       // 4 zero bits
+    for(;;){
+        gf2_square(even,odd);
+        if(length2&1)crc1=gf2_times(even,crc1);
+        length2>>=1;
+        if(!length2)break;
+        gf2_square(odd,even);
+        if(length2&1)crc1=gf2_times(odd,crc1);
+        length2>>=1;
+        if(!length2)break;
+    }
+    return crc1^crc2;
+}
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef DECODE_TABLE_HPP
+#define DECODE_TABLE_HPP
+
+#include<iostream>
+#include<vector>
+#include<cstdlib>
+#include<algorithm>
+#include "bit_reader.hpp"
+
+struct decode_entry{
+    unsigned int link;          // start of the sub table for codes longer than the current table, 0 if this entry holds symbols
+    unsigned char symbol[2];
+    unsigned char length;       // code length of symbol[0] (or bit width of the sub table if this is a link)
+    unsigned char length2;      // total code length of symbol[0] and symbol[1], 0 if the second symbol does not fit
+};
+
+struct code_entry{
+    unsigned long long bits;    // code, left aligned
+    int length;
+    unsigned char symbol;
+};
+
+// thrown by decode_table::throw_corrupted
+struct corrupted_data{};
+
+struct decode_table{
+    // Instead of walking the translation tree one bit at a time, the decoder looks at the next BITS bits
+    // and finds every whole code inside them with a single lookup.
+    // Codes that are longer than BITS continue inside sub tables that are stored after the main table.
+    // An entry with length==0 and link==0 belongs to a bit pattern that no code starts with.
+    static const int BITS=11;
+    std::vector<decode_entry> entries;
+    std::vector<unsigned char> streams;     // the streams of an interleaved block if they are not in memory already
+
+    // fills length2 and symbol[1] of the main table entries whose remaining bits hold another whole code
+    void pair_symbols(){
+        const unsigned int mask=(1<<BITS)-1;
+        for(unsigned int i=0;i<=mask;i++){
+            decode_entry &e=entries[i];
+            e.length2=0;
+            if(e.link||!e.length||e.length>=BITS)continue;
+            const decode_entry &f=entries[(i<<e.length)&mask];
+            if(f.link||!f.length||f.length>BITS-e.length)continue;
+            e.symbol[1]=f.symbol[0];
+            e.length2=e.length+f.length;
+        }
+    }
+
+    // builds the table straight from the lengths and codes of a canonical code (length[x]==0 if x is not used)
+        // codes are sorted as left aligned numbers, so the codes that share the first bits of a sub table
+        // come one after another and every sub table is filled from a single range of them
+    void build(const int *length,const unsigned long long *code){
+        std::vector<code_entry> codes;
+        for(int i=0;i<256;i++){
+            if(!length[i])continue;
+            if(length[i]>64||(length[i]<64&&code[i]>>length[i]))corrupted();
+            codes.push_back({code[i]<<(64-length[i]),length[i],(unsigned char)i});
+        }
+        std::sort(codes.begin(),codes.end(),[](const code_entry &a,const code_entry &b){return a.bits<b.bits;});
+        entries.clear();
+        fill(codes,0,codes.size(),0,BITS);
+        pair_symbols();
+    }
+
+    // called when the compressed data can't be valid
+        // the programs print a message and exit, the library (huffman.cpp) replaces the handler of its thread
+        // with throw_corrupted through a corruption_guard while it decodes
+    static void exit_corrupted(){
+        std::cout<<"Compressed file is corrupted"<<std::endl<<"Process has been aborted"<<std::endl;
+        exit(1);
+    }
+    static void throw_corrupted(){
+        throw corrupted_data();
+    }
+    static void (*&corruption_handler())(){
+        static thread_local void (*handler)()=exit_corrupted;
+        return handler;
+    }
+    static void corrupted(){
+        corruption_handler()();
+        exit(1);
+    }
+
+    // creates a table of 2^width entries for codes[first,last), whose first 'consumed' bits are already looked up,
+    // and returns where it starts inside entries
+    unsigned int fill(const std::vector<code_entry> &codes,size_t first,size_t last,int consumed,int width){
+        unsigned int start=entries.size();
+        entries.resize(start+(1u<<width));
+        for(size_t i=first;i<last;){
+            const code_entry &c=codes[i];
+            unsigned int index=c.bits<<consumed>>(64-width);
+            int rest=c.length-consumed;
+            if(entries[start+index].length)corrupted();     // two codes start the same way
+            if(rest<=width){
+                decode_entry entry={0,{c.symbol,0},(unsigned char)rest,0};
+                for(unsigned int j=0;j<(1u<<(width-rest));j++){
+                    entries[start+index+j]=entry;
+                }
+                i++;
+            }
+            else{
+                size_t end=i;
+                int longest=0;
+                for(;end<last&&(unsigned int)(codes[end].bits<<consumed>>(64-width))==index;end++){
+                    if(codes[end].length<=consumed+width)corrupted();
+                    if(codes[end].length>longest)longest=codes[end].length;
+                }
+                int sub_width=longest-consumed-width<BITS?longest-consumed-width:BITS;
+                unsigned int link=fill(codes,i,end,consumed+width,sub_width);
+                entries[start+index].link=link;
+                entries[start+index].length=sub_width;
+                i=end;
+            }
+        }
+        return start;
+    }
+
+    // decodes a single symbol, following sub tables if necessary
+    unsigned char decode_one(bit_reader &in){
+        if(in.count<BITS)in.refill();
+        const decode_entry *e=&entries[in.peek(BITS)];
+        if(e->link){
+            in.consume(BITS);
+            for(;;){
+                int width=e->length;
+                if(in.count<width)in.refill();
+                e=&entries[e->link+in.peek(width)];
+                if(!e->link)break;
+                in.consume(width);
+            }
+        }
+        if(!e->length)corrupted();
+        in.consume(e->length);
+        return e->symbol[0];
+    }
+
+    // decodes one or two symbols from a main table entry (refill() has to leave at least BITS bits)
+        // a code that is longer than BITS can use up most of the bits inside the reader, so the reader is refilled
+        // after it and the next lookup of the caller still sees BITS bits
+    void decode_step(bit_reader &in,unsigned char *&out){
+        const decode_entry &e=entries[in.peek(BITS)];
+        if(e.length2){
+            out[0]=e.symbol[0];
+            out[1]=e.symbol[1];
+            out+=2;
+            in.consume(e.length2);
+        }
+        else if(!e.link&&e.length){
+            *out++=e.symbol[0];
+            in.consume(e.length);
+        }
+        else{
+            *out++=decode_one(in);
+            in.refill();
+        }
+    }
+
+    // decodes n symbols into out
+        // a refill leaves at least 57 bits inside the reader, so 4 lookups of at most BITS bits
+        // can be done before the next refill. Long codes go through decode_one and decode_step refills after them.
+    void decode(bit_reader &in,unsigned char *out,long int n){
+        unsigned char *stop=out+n;
+        while(stop-out>=8){
+            in.refill();
+            for(int i=0;i<4;i++){
+                decode_step(in,out);
+            }
+        }
+        while(out<stop){
+            *out++=decode_one(in);
+        }
+    }
+
+    // decodes 4 independent streams at the same time, stream k gives the symbols of out[k] up to stop[k]
+        // the lookups of the four readers don't depend on each other, so the processor can overlap them
+        // instead of waiting for every code length before it can look at the next code.
+        // Like decode, every reader is refilled once for 4 lookups, and decode_step refills a reader after a long code
+    void decode4(bit_reader *in,unsigned char **out,unsigned char *const *stop){
+        for(;;){
+            bool room=true;
+            for(int k=0;k<4;k++){
+                if(stop[k]-out[k]<8)room=false;
+            }
+            if(!room)break;
+            for(int k=0;k<4;k++){
+                in[k].refill();
+            }
+            for(int i=0;i<4;i++){
+                decode_step(in[0],out[0]);
+                decode_step(in[1],out[1]);
+                decode_step(in[2],out[2]);
+                decode_step(in[3],out[3]);
+            }
+        }
+        for(int k=0;k<4;k++){
+            decode(in[k],out[k],stop[k]-out[k]);
+        }
+    }
+};
+
+// replaces the corruption handler of the calling thread and puts the old one back when it goes out of scope
+struct corruption_guard{
+    void (*saved)();
+    explicit corruption_guard(void (*handler)()):saved(decode_table::corruption_handler()){
+        decode_table::corruption_handler()=handler;
+    }
+    corruption_guard(const corruption_guard&)=delete;
+    corruption_guard& operator=(const corruption_guard&)=delete;
+    ~corruption_guard(){
+        decode_table::corruption_handler()=saved;
+    }
+};
+
+#endif
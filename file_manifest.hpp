@@ -0,0 +1,122 @@
+#ifndef FILE_MANIFEST_HPP
+#define FILE_MANIFEST_HPP
+
+#include<string>
+#include<vector>
+#include<utility>
+#include<dirent.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/stat.h>
+
+/*  The files and folders of the inputs, scanned once before the archive is written
+    Both passes of the compressors (counting and writing) walk the same list instead of reading the folders again.
+    Entries are in the order they are written into the archive: the inputs in the order they were given,
+    every folder followed by everything inside it (in readdir order, like before).
+    The type of an entry comes from d_type, only entries whose d_type is not enough (symbolic links, file systems
+    that don't fill it) and files (for their sizes) need an fstatat() relative to their folder.
+    Folders are scanned as OpenMP tasks, so the folders of a large tree are read by many threads at the same time
+    (programs that are built without OpenMP scan them one after another).
+    Symbolic links are followed, entries that can't be stat'ed are files of 0 bytes and folders that can't be
+    opened are empty.
+*/
+
+struct manifest_entry{
+    std::string path;       // the input itself, or the path of its folder + '/' + its name
+    size_t name;            // where its name starts inside path (0 for the inputs)
+    bool folder;
+    long int size;          // files: size in bytes when they were scanned
+    int entries;            // folders: number of files and folders directly inside
+};
+
+struct scanned_folder{
+    std::vector<manifest_entry> entries;
+    std::vector<scanned_folder> folders;    // one for each folder among entries, in the same order
+};
+
+inline void scan_folder(const std::string &path,scanned_folder &folder){
+    int fd=open(path.c_str(),O_RDONLY|O_DIRECTORY);
+    if(fd<0)return;
+    DIR *dir=fdopendir(fd);
+    if(!dir){
+        close(fd);
+        return;
+    }
+    struct dirent *current;
+    int folder_count=0;
+    while((current=readdir(dir))){
+        if(current->d_name[0]=='.'){
+            if(current->d_name[1]==0)continue;
+            if(current->d_name[1]=='.'&&current->d_name[2]==0)continue;
+        }
+        manifest_entry entry={path+'/'+current->d_name,path.size()+1,current->d_type==DT_DIR,0,0};
+        if(!entry.folder){
+            struct stat st;
+            if(!fstatat(fd,current->d_name,&st,0)){
+                entry.folder=S_ISDIR(st.st_mode);
+                if(!entry.folder)entry.size=st.st_size;
+            }
+        }
+        folder_count+=entry.folder;
+        folder.entries.push_back(std::move(entry));
+    }
+    closedir(dir);
+    folder.folders.resize(folder_count);
+    scanned_folder *next=folder.folders.data();
+    for(const manifest_entry &entry:folder.entries){
+        if(!entry.folder)continue;
+        scanned_folder *inside=next++;
+#ifdef _OPENMP
+        #pragma omp task firstprivate(inside)
+#endif
+        scan_folder(entry.path,*inside);
+    }
+#ifdef _OPENMP
+    #pragma omp taskwait
+#endif
+}
+
+// appends the entries of a scanned folder and everything inside them in the order of the archive
+inline void flatten_folder(scanned_folder &folder,std::vector<manifest_entry> &manifest){
+    scanned_folder *next=folder.folders.data();
+    for(manifest_entry &entry:folder.entries){
+        manifest.push_back(std::move(entry));
+        if(manifest.back().folder){
+            manifest.back().entries=next->entries.size();
+            flatten_folder(*next,manifest);
+            *next++=scanned_folder();
+        }
+    }
+}
+
+// scans the inputs (argv[1] to argv[argc-1])
+inline void build_manifest(int argc,char **argv,std::vector<manifest_entry> &manifest){
+    scanned_folder inputs;
+    inputs.folders.resize(argc>1?argc-1:0);
+    for(int i=1;i<argc;i++){
+        struct stat st;
+        bool exists=!stat(argv[i],&st);
+        inputs.entries.push_back({argv[i],0,exists&&S_ISDIR(st.st_mode),exists&&!S_ISDIR(st.st_mode)?(long int)st.st_size:0,0});
+    }
+#ifdef _OPENMP
+    #pragma omp parallel
+    #pragma omp single
+#endif
+    for(int i=1;i<argc;i++){
+        if(!inputs.entries[i-1].folder)continue;
+#ifdef _OPENMP
+        #pragma omp task firstprivate(i)
+#endif
+        scan_folder(inputs.entries[i-1].path,inputs.folders[i-1]);
+    }
+    // flatten_folder expects the folders of the inputs one after another
+    std::vector<scanned_folder> folders;
+    for(int i=1;i<argc;i++){
+        if(inputs.entries[i-1].folder)folders.push_back(std::move(inputs.folders[i-1]));
+    }
+    inputs.folders.swap(folders);
+    manifest.clear();
+    flatten_folder(inputs,manifest);
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include<cstddef>
+#include<cstring>
+
+#if defined(__GNUC__)&&(defined(__x86_64__)||defined(__i386__))
+#include<immintrin.h>
+#define HISTOGRAM_X86
+#endif
+
+/*  Byte frequency counting
+    A plain number[x]++ loop stalls whenever the same byte comes again before the previous increment
+    is stored (logs, zero filled images, ...). The kernels below spread successive bytes over 8
+    separate sub-histograms so that neighbouring increments never wait for each other,
+    and the SIMD versions add a whole vector at once when it is made of a single repeated byte.
+    Sub-histograms use 32 bit counters, so the input is counted in segments that cannot overflow them.
+*/
+
+const size_t histogram_segment=1<<30;
+
+typedef void (*histogram_kernel)(const unsigned char*,size_t,unsigned int (*)[256]);
+
+inline void count_8_bytes(const unsigned char *p,unsigned int (*t)[256]){
+    unsigned long long w;
+    memcpy(&w,p,8);
+    t[0][w&255]++;
+    t[1][(w>>8)&255]++;
+    t[2][(w>>16)&255]++;
+    t[3][(w>>24)&255]++;
+    t[4][(w>>32)&255]++;
+    t[5][(w>>40)&255]++;
+    t[6][(w>>48)&255]++;
+    t[7][w>>56]++;
+}
+
+inline void histogram_generic(const unsigned char *p,size_t n,unsigned int (*t)[256]){
+    const unsigned char *end=p+n;
+    for(;end-p>=16;p+=16){
+        count_8_bytes(p,t);
+        count_8_bytes(p+8,t);
+    }
+    for(;p<end;p++)t[0][*p]++;
+}
+
+#ifdef HISTOGRAM_X86
+__attribute__((target("sse2")))
+inline void histogram_sse2(const unsigned char *p,size_t n,unsigned int (*t)[256]){
+    const unsigned char *end=p+n;
+    for(;end-p>=16;p+=16){
+        __m128i v=_mm_loadu_si128((const __m128i*)p);
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(v,_mm_set1_epi8(p[0])))==0xFFFF){
+            t[0][p[0]]+=16;         // 16 copies of the same byte
+            continue;
+        }
+        count_8_bytes(p,t);
+        count_8_bytes(p+8,t);
+    }
+    for(;p<end;p++)t[0][*p]++;
+}
+
+__attribute__((target("avx2")))
+inline void histogram_avx2(const unsigned char *p,size_t n,unsigned int (*t)[256]){
+    const unsigned char *end=p+n;
+    for(;end-p>=32;p+=32){
+        __m256i v=_mm256_loadu_si256((const __m256i*)p);
+        if(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v,_mm256_set1_epi8(p[0])))==-1){
+            t[0][p[0]]+=32;         // 32 copies of the same byte
+            continue;
+        }
+        count_8_bytes(p,t);
+        count_8_bytes(p+8,t);
+        count_8_bytes(p+16,t);
+        count_8_bytes(p+24,t);
+    }
+    for(;p<end;p++)t[0][*p]++;
+}
+#endif
+
+// adds the usage frequency of every byte inside data to number[256] using the given kernel
+inline void count_bytes_with(histogram_kernel kernel,const unsigned char *data,size_t n,long int *number){
+    if(n<4096){     // clearing the sub-histograms would cost more than it saves
+        for(const unsigned char *end=data+n;data<end;data++){
+            number[*data]++;
+        }
+        return;
+    }
+    unsigned int t[8][256];
+    while(n){
+        size_t segment=n<histogram_segment?n:histogram_segment;
+        memset(t,0,sizeof(t));
+        kernel(data,segment,t);
+        for(int i=0;i<256;i++){
+            number[i]+=(long int)t[0][i]+t[1][i]+t[2][i]+t[3][i]+t[4][i]+t[5][i]+t[6][i]+t[7][i];
+        }
+        data+=segment;
+        n-=segment;
+    }
+}
+
+// picks the fastest kernel the processor supports, once
+inline histogram_kernel best_histogram_kernel(){
+#ifdef HISTOGRAM_X86
+    static histogram_kernel kernel=__builtin_cpu_supports("avx2")?histogram_avx2:
+                                   __builtin_cpu_supports("sse2")?histogram_sse2:histogram_generic;
+    return kernel;
+#else
+    return histogram_generic;
+#endif
+}
+
+inline void count_bytes(const unsigned char *data,size_t n,long int *number){
+    count_bytes_with(best_histogram_kernel(),data,n,number);
+}
+
+#endif
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <chrono>
+#include "histogram.hpp"
+
+// Microbenchmark for the byte frequency kernels in histogram.hpp
+// usage: ./histogram_bench [size_in_MiB] [repetitions]
+
+struct kernel_info
+{
+  const char *name;
+  histogram_kernel kernel;
+};
+
+struct input_info
+{
+  std::string name;
+  std::vector<unsigned char> data;
+};
+
+double measure(histogram_kernel kernel, const std::vector<unsigned char> &data, int repetitions, long int *number)
+{
+  double best = 1e30;
+  for (int r = 0; r < repetitions; r++)
+  {
+    for (int i = 0; i < 256; i++)
+      number[i] = 0;
+    auto start = std::chrono::steady_clock::now();
+    count_bytes_with(kernel, &data[0], data.size(), number);
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    if (seconds < best)
+      best = seconds;
+  }
+  return data.size() / best / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+  size_t size = (argc > 1 ? atol(argv[1]) : 64) << 20;
+  int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+
+  std::vector<kernel_info> kernels;
+  kernels.push_back({"plain", NULL});
+  kernels.push_back({"generic", histogram_generic});
+#ifdef HISTOGRAM_X86
+  if (__builtin_cpu_supports("sse2"))
+    kernels.push_back({"sse2", histogram_sse2});
+  if (__builtin_cpu_supports("avx2"))
+    kernels.push_back({"avx2", histogram_avx2});
+#endif
+
+  std::vector<input_info> inputs(4);
+  srand(1);
+  inputs[0].name = "uniform";
+  inputs[1].name = "skewed (90% one byte)";
+  inputs[2].name = "text-like";
+  inputs[3].name = "zeros";
+  for (size_t i = 0; i < size; i++)
+  {
+    inputs[0].data.push_back(rand() & 255);
+    inputs[1].data.push_back(rand() % 10 ? 0 : rand() & 255);
+    inputs[2].data.push_back("eeeeettttaaaoooiinnsshhrrdl \n"[rand() % 29]);
+    inputs[3].data.push_back(0);
+  }
+
+  std::cout << "Histogram kernels on " << (size >> 20) << " MiB, best of " << repetitions << " runs (GB/s)\n";
+  std::cout << std::left << std::setw(24) << "Input";
+  for (size_t k = 0; k < kernels.size(); k++)
+    std::cout << std::right << std::setw(10) << kernels[k].name;
+  std::cout << std::endl;
+
+  for (size_t i = 0; i < inputs.size(); i++)
+  {
+    long int reference[256], number[256];
+    for (int j = 0; j < 256; j++)
+      reference[j] = 0;
+    for (size_t j = 0; j < size; j++)
+      reference[inputs[i].data[j]]++;
+
+    std::cout << std::left << std::setw(24) << inputs[i].name;
+    for (size_t k = 0; k < kernels.size(); k++)
+    {
+      double speed;
+      if (kernels[k].kernel)
+      {
+        speed = measure(kernels[k].kernel, inputs[i].data, repetitions, number);
+      }
+      else
+      { // the plain number[x]++ loop, for comparison
+        double best = 1e30;
+        for (int r = 0; r < repetitions; r++)
+        {
+          for (int j = 0; j < 256; j++)
+            number[j] = 0;
+          auto start = std::chrono::steady_clock::now();
+          const unsigned char *p = &inputs[i].data[0];
+          for (size_t j = 0; j < size; j++)
+            number[p[j]]++;
+          auto end = std::chrono::steady_clock::now();
+          double seconds = std::chrono::duration<double>(end - start).count();
+          if (seconds < best)
+            best = seconds;
+        }
+        speed = size / best / 1e9;
+      }
+      for (int j = 0; j < 256; j++)
+      {
+        if (number[j] != reference[j])
+        {
+          std::cerr << kernels[k].name << " kernel counted wrong on " << inputs[i].name << std::endl;
+          return 1;
+        }
+      }
+      std::cout << std::right << std::setw(10) << std::fixed << std::setprecision(2) << speed;
+    }
+    std::cout << std::endl;
+  }
+  return 0;
+}
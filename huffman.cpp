@@ -0,0 +1,197 @@
+#include<algorithm>
+#include "huffman.hpp"
+#include "block_format.hpp"
+#include "block_decoder.hpp"
+
+// decode_table reports invalid data through its corruption handler, the programs exit there
+// but a library can't, so push() makes it throw on the calling thread and catches it
+static void throw_corrupted(){
+    decode_table::throw_corrupted();
+}
+
+static const unsigned long long unknown_size=~0ULL;
+
+
+
+huffman_encoder::huffman_encoder(output_sink &o,int max_length,long long size,bool interleave)
+    :out(o),sized(size>=0),interleaved(interleave),writer(new bit_writer(NULL,default_block_size+1024)){
+    max_code_length=std::max(min_code_length_limit,std::min(max_length,max_code_length_limit));
+    for(int i=0;i<3;i++)writer->write_byte(stream_magic[i]);
+    writer->write_byte(block_format_version);
+    write_number(sized?size:unknown_size,8,*writer);
+    flush();
+}
+
+huffman_encoder::~huffman_encoder(){}
+
+// blocks end on byte boundaries, so everything in the writer can be given out after each of them
+void huffman_encoder::flush(){
+    writer->finish();
+    out.write(&writer->buffer[0],writer->used);
+    writer->clear();
+}
+
+void huffman_encoder::encode(const uint8_t *data,size_t n){
+    encode_block(data,n,*writer,max_code_length,interleaved);
+    flush();
+}
+
+void huffman_encoder::push(const uint8_t *data,size_t n){
+    while(n){
+        if(pending.empty()&&n>=(size_t)default_block_size){     // whole blocks are encoded where they are
+            encode(data,default_block_size);
+            data+=default_block_size;
+            n-=default_block_size;
+            continue;
+        }
+        size_t take=std::min(n,default_block_size-pending.size());
+        pending.insert(pending.end(),data,data+take);
+        data+=take;
+        n-=take;
+        if(pending.size()==(size_t)default_block_size){
+            encode(&pending[0],pending.size());
+            pending.clear();
+        }
+    }
+}
+
+void huffman_encoder::finish(){
+    if(pending.size()){
+        encode(&pending[0],pending.size());
+        pending.clear();
+    }
+    if(!sized){
+        writer->write_byte(BLOCK_END);
+        flush();
+    }
+}
+
+
+
+huffman_decoder::huffman_decoder(output_sink &o):out(o),table(new decode_table){}
+
+huffman_decoder::~huffman_decoder(){}
+
+// returns the length of the next piece if the first 'available' bytes are enough to tell,
+// otherwise how many bytes are needed to tell (as a negative number)
+long long huffman_decoder::piece_size(const uint8_t *p,size_t available){
+    if(!header_read)return stream_header_size;
+    if(available<1)return -1;
+    switch(p[0]){
+        case BLOCK_END:
+        return 1;
+        case BLOCK_SINGLE:
+        return 6;
+        case BLOCK_STORED:
+        case BLOCK_HUFFMAN:
+        case BLOCK_HUFFMAN4:{
+            if(available<6)return -6;
+            long long n=p[1]|p[2]<<8|p[3]<<16|(long long)p[4]<<24;
+            if(n<=0||n>max_block_size)throw_corrupted();
+            if(p[0]==BLOCK_STORED)return 5+n;
+            long long header=5+code_lengths_size(p[5]+1)+4;
+            if((long long)available<header)return -header;
+            const uint8_t *q=p+header-4;
+            long long payload=q[0]|q[1]<<8|q[2]<<16|(long long)q[3]<<24;
+            if(payload>8*n+(p[0]==BLOCK_HUFFMAN4?12:0))throw_corrupted();     // codes are never longer than 64 bits
+            return header+payload;
+        }
+    }
+    throw_corrupted();
+    return 0;
+}
+
+void huffman_decoder::decode_piece(const uint8_t *p,size_t n){
+    if(!header_read){
+        long long size=0;
+        for(int i=11;i>=4;i--)size=size<<8|p[i];
+        if(memcmp(p,stream_magic,3)||p[3]!=block_format_version)throw_corrupted();
+        header_read=true;
+        sized=(unsigned long long)size!=unknown_size;
+        if(sized&&size<0)throw_corrupted();
+        remaining=size;
+        finished=sized&&size==0;
+        return;
+    }
+    if(p[0]==BLOCK_END){
+        if(sized)throw_corrupted();
+        finished=true;
+        return;
+    }
+    bit_reader in(p,n);
+    long int m=decode_block(in,*table,block,sized?remaining:max_block_size);
+    if(in.position()!=(long int)n)throw_corrupted();
+    out.write(&block[0],m);
+    if(sized){
+        remaining-=m;
+        finished=remaining==0;
+    }
+}
+
+bool huffman_decoder::push(const uint8_t *data,size_t n){
+    if(failed)return false;
+    corruption_guard guard(decode_table::throw_corrupted);
+    try{
+        for(;;){
+            if(finished){
+                if(n||pending.size())failed=true;       // nothing can follow the end of the stream
+                return !failed;
+            }
+            if(pending.empty()&&n==0)return true;
+            // pieces are decoded where they are, only pieces that are split between pushes are collected in pending
+            bool collecting=pending.size();
+            const uint8_t *p=collecting?&pending[0]:data;
+            size_t available=collecting?pending.size():n;
+            long long size=piece_size(p,available);
+            size_t wanted=size<0?-size:size;
+            if(available<wanted){
+                if(!collecting){
+                    pending.assign(data,data+n);
+                    return true;
+                }
+                size_t take=std::min(n,wanted-available);
+                pending.insert(pending.end(),data,data+take);
+                data+=take;
+                n-=take;
+                if(take<wanted-available)return true;
+                continue;
+            }
+            decode_piece(p,size);
+            if(collecting){
+                pending.clear();
+            }
+            else{
+                data+=size;
+                n-=size;
+            }
+        }
+    }
+    catch(corrupted_data&){
+        failed=true;
+        return false;
+    }
+}
+
+bool huffman_decoder::finish(){
+    return !failed&&finished;
+}
+
+
+
+void huffman_encode(const uint8_t *data,size_t n,output_sink &out,int max_code_length){
+    huffman_encoder encoder(out,max_code_length,n);
+    encoder.push(data,n);
+    encoder.finish();
+}
+
+long long huffman_decoded_size(const uint8_t *data,size_t n){
+    if(n<stream_header_size||memcmp(data,stream_magic,3)||data[3]!=block_format_version)return -1;
+    long long size=0;
+    for(int i=11;i>=4;i--)size=size<<8|data[i];
+    return size<0?-1:size;
+}
+
+bool huffman_decode(const uint8_t *data,size_t n,output_sink &out){
+    huffman_decoder decoder(out);
+    return decoder.push(data,n)&&decoder.finish();
+}
@@ -0,0 +1,103 @@
+#ifndef HUFFMAN_HPP
+#define HUFFMAN_HPP
+
+#include<cstddef>
+#include<cstdint>
+#include<cstdio>
+#include<memory>
+#include<vector>
+
+/*  libhuffman: Huffman coding of buffers in memory (make libhuffman.a, link with -L. -lhuffman)
+    huffman_encode turns a buffer into a stream of blocks, the same blocks the archives of block mode use
+    (see block_format.hpp), so every 256 KiB of the input gets its own table.
+    huffman_decode turns such a stream back into the original bytes.
+    Results are given to an output_sink piece by piece, so the caller decides where the bytes go.
+
+    huffman_encoder and huffman_decoder do the same incrementally: data is pushed in whatever pieces it arrives in
+    (from a pipe or a socket) and the results come out as soon as a block is complete,
+    so they never hold more than one block no matter how long the stream is.
+*/
+
+struct output_sink{
+    virtual void write(const uint8_t *data,size_t n)=0;
+    virtual ~output_sink(){}
+};
+
+// collects everything in a vector
+struct vector_sink:output_sink{
+    std::vector<uint8_t> data;
+    void write(const uint8_t *p,size_t n){
+        data.insert(data.end(),p,p+n);
+    }
+};
+
+// writes everything to a file (stdout for example)
+struct file_sink:output_sink{
+    FILE *fp;
+    bool failed=false;
+    explicit file_sink(FILE *f):fp(f){}
+    void write(const uint8_t *p,size_t n){
+        if(fwrite(p,1,n,fp)!=n)failed=true;
+    }
+};
+
+// max_code_length can be between 8 and 32, codes are limited to 15 bits by default
+void huffman_encode(const uint8_t *data,size_t n,output_sink &out,int max_code_length=15);
+
+// returns false if data is not a complete stream created by huffman_encode or huffman_encoder
+    // (out may have been given the beginning of the original bytes by then)
+bool huffman_decode(const uint8_t *data,size_t n,output_sink &out);
+
+// returns the length of the original bytes of a stream, or -1 if data does not start like one
+    // or if the length was not known when it was written (streams of huffman_encoder without a size)
+long long huffman_decoded_size(const uint8_t *data,size_t n);
+
+
+
+struct bit_writer;
+struct decode_table;
+
+class huffman_encoder{
+public:
+    // size is the total length that is going to be pushed, if it is known (-1 if not)
+    // interleaved blocks are split into 4 streams that are decoded side by side (mode 4 of block_format.hpp)
+    explicit huffman_encoder(output_sink &out,int max_code_length=15,long long size=-1,bool interleaved=false);
+    ~huffman_encoder();
+    void push(const uint8_t *data,size_t n);
+    void finish();      // encodes the rest, nothing can be pushed after it
+
+private:
+    output_sink &out;
+    int max_code_length;
+    bool sized;
+    bool interleaved;
+    std::vector<uint8_t> pending;           // the beginning of the next block
+    std::unique_ptr<bit_writer> writer;
+    void encode(const uint8_t *data,size_t n);
+    void flush();
+};
+
+class huffman_decoder{
+public:
+    explicit huffman_decoder(output_sink &out);
+    ~huffman_decoder();
+    // returns false once the data turned out to be invalid, every later call returns false too
+    bool push(const uint8_t *data,size_t n);
+    // returns true if the whole stream has been pushed
+    bool finish();
+    bool done() const{
+        return finished;
+    }
+
+private:
+    output_sink &out;
+    bool header_read=false,sized=false,finished=false,failed=false;
+    long long remaining=0;                  // original bytes that are still missing (if the size is known)
+    std::vector<uint8_t> pending;           // the beginning of the next piece (the header or a block)
+    std::vector<uint8_t> block;
+    std::unique_ptr<decode_table> table;
+    long long piece_size(const uint8_t *p,size_t available);
+    void decode_piece(const uint8_t *p,size_t n);
+};
+
+#endif
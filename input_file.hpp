@@ -0,0 +1,106 @@
+#ifndef INPUT_FILE_HPP
+#define INPUT_FILE_HPP
+
+#include<vector>
+#include<cstring>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+
+struct input_file{
+    // gives the contents of an input file in large pieces instead of one fread call per byte
+    // the file is mapped into memory when that is possible, otherwise it is read in pieces of piece_size bytes
+    static const long int piece_size=1<<22;
+    int fd=-1;
+    long int size=0;
+    long int offset=0;              // where the next piece starts
+    unsigned char *map=NULL;
+    std::vector<unsigned char> chunk;
+
+    input_file(){}
+    input_file(const input_file&)=delete;
+    input_file& operator=(const input_file&)=delete;
+    ~input_file(){
+        close();
+    }
+
+    bool open(const char *path){
+        close();
+        fd=::open(path,O_RDONLY);
+        if(fd<0)return false;
+        struct stat st;
+        if(fstat(fd,&st)){
+            close();
+            return false;
+        }
+        size=st.st_size;
+        offset=0;
+        if(size>0){
+            void *p=mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0);
+            if(p!=MAP_FAILED){
+                map=(unsigned char*)p;
+                madvise(map,size,MADV_SEQUENTIAL);
+            }
+        }
+        return true;
+    }
+
+    // points data at the next piece of the file (at most limit bytes) and returns its length,
+    // returns 0 at the end of the file
+    long int next(const unsigned char *&data,long int limit=piece_size){
+        long int n=size-offset;
+        if(n>limit)n=limit;
+        if(n<=0)return 0;
+        if(map){
+            data=map+offset;
+        }
+        else{
+            if((long int)chunk.size()<n)chunk.resize(n);
+            long int got=0;
+            while(got<n){
+                ssize_t r=read(fd,&chunk[got],n-got);
+                if(r<=0)break;
+                got+=r;
+            }
+            n=got;
+            data=&chunk[0];
+        }
+        offset+=n;
+        return n;
+    }
+
+    // returns n bytes of the file that start at offset without changing where next() continues
+        // (the bytes are read into buffer if the file is not mapped, different threads can call it with their own buffers)
+    const unsigned char *piece(long int offset,long int n,std::vector<unsigned char> &buffer){
+        if(map)return map+offset;
+        if((long int)buffer.size()<n)buffer.resize(n);
+        long int got=0;
+        while(got<n){
+            ssize_t r=pread(fd,&buffer[got],n-got,offset+got);
+            if(r<=0)break;
+            got+=r;
+        }
+        if(got<n)memset(&buffer[got],0,n-got);
+        return &buffer[0];
+    }
+
+    // the next piece will start at position
+    void seek(long int position){
+        offset=position;
+        if(!map)lseek(fd,position,SEEK_SET);
+    }
+
+    void close(){
+        if(map){
+            munmap(map,size);
+            map=NULL;
+        }
+        if(fd>=0){
+            ::close(fd);
+            fd=-1;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include<iostream>
+#include<fstream>
+#include<string>
+#include<cstring>
+#include<cstdlib>
+#include "block_format.hpp"
+
+/*  Command line options shared by archive, modified_archive and extract
+    Options come before the file names, the first argument that does not start with '-' ends them ("--" too).
+
+    -o {{path}}                 archive: name of the compressed file (default: first input + ".compressed")
+                                extract: folder to extract into (created if it does not exist)
+    --no-confirm                does not ask anything: no password unless --password-file is given,
+                                and the compression starts without waiting for confirmation
+    --password-file {{path}}    takes the password from the first line of a file instead of asking for it
+    -j {{threads}}              number of threads (modified_archive and extract)
+    --level {{1-9}}             block mode, lower levels limit codes to fewer bits (faster decoding),
+                                level 5 is the same as --blocks
+    --blocks                    block mode (see block_format.hpp)
+    --interleave                block mode with 4 streams in every translated block (mode 4 of block_format.hpp),
+                                they are decoded side by side, which makes extract faster
+    --max-code-length {{bits}}  codes are not longer than this
+    --single-pass               reads every file once (archive, see Compressor.cpp)
+    -c                          stream mode: one file or stdin ("-") to stdout (see stream_mode.hpp)
+    --list                      extract: prints the files and folders of the archive instead of extracting them
+    --progress {{bar|json|off}}  how the progress is reported on stderr (see progress_bar.hpp),
+                                default: bar if stderr is a terminal, off otherwise
+    --direct                    extract: files of 4 MiB or more are written with O_DIRECT, past the page cache
+                                (see output_file.hpp)
+    --stats                     prints the time, throughput and system calls of every phase to stderr (see stats.hpp)
+*/
+
+struct archive_options{
+    std::string output;
+    bool confirm=true;
+    bool ask_password=true;
+    std::string password;
+    int threads=0;              // 0: OpenMP decides
+    int version=1;              // archive version to write
+    int max_code_length=default_max_code_length;
+    bool interleaved=false;     // version 2 blocks are split into 4 streams
+    bool single_pass=false;
+    bool stream=false;
+    bool list=false;
+    std::string progress;       // empty: the default of progress_bar.hpp
+    bool stats=false;
+    bool direct_io=false;
+};
+
+// reads the first line of a file, returns false if it can't be read
+inline bool read_password_file(const char *path,std::string &password){
+    std::ifstream file(path);
+    if(!file.is_open())return false;
+    std::getline(file,password);
+    while(password.size()&&(password.back()=='\r'||password.back()=='\n'))password.pop_back();
+    return true;
+}
+
+// reads the options at the beginning of argv and removes them, so argv[1] becomes the first file name
+    // returns false (after printing why to stderr, which can't mix with the data of stream mode) if an option is wrong
+    // ("-" alone is a file name, the one of stdin in stream mode)
+inline bool parse_options(int &argc,char **&argv,archive_options &options){
+    while(argc>1&&argv[1][0]=='-'&&argv[1][1]){
+        std::string option=argv[1];
+        const char *value=argc>2?argv[2]:NULL;
+        int used=1;
+        if(option=="--"){
+            argv++;
+            argc--;
+            break;
+        }
+        else if(option=="--no-confirm"){
+            options.confirm=false;
+            options.ask_password=false;
+        }
+        else if(option=="--blocks"){
+            options.version=2;
+        }
+        else if(option=="--interleave"){
+            options.version=2;
+            options.interleaved=true;
+        }
+        else if(option=="--single-pass"){
+            options.single_pass=true;
+        }
+        else if(option=="-c"){
+            options.stream=true;
+        }
+        else if(option=="--list"){
+            options.list=true;
+        }
+        else if(option=="--stats"){
+            options.stats=true;
+        }
+        else if(option=="--direct"){
+            options.direct_io=true;
+        }
+        else if(option=="-o"||option=="--password-file"||option=="-j"||option=="--level"||option=="--max-code-length"||option=="--progress"){
+            if(!value){
+                std::cerr<<option<<" needs a value"<<std::endl;
+                return false;
+            }
+            used=2;
+            if(option=="-o"){
+                options.output=value;
+            }
+            else if(option=="--password-file"){
+                if(!read_password_file(value,options.password)){
+                    std::cerr<<value<<" can not be read"<<std::endl;
+                    return false;
+                }
+                options.ask_password=false;
+            }
+            else if(option=="-j"){
+                options.threads=atoi(value);
+                if(options.threads<1){
+                    std::cerr<<"Thread count has to be at least 1"<<std::endl;
+                    return false;
+                }
+            }
+            else if(option=="--level"){
+                int level=atoi(value);
+                if(level<1||level>9){
+                    std::cerr<<"Level has to be between 1 and 9"<<std::endl;
+                    return false;
+                }
+                options.version=2;
+                options.max_code_length=10+level;
+            }
+            else if(option=="--progress"){
+                options.progress=value;
+                if(options.progress!="bar"&&options.progress!="json"&&options.progress!="off"){
+                    std::cerr<<"Progress has to be bar, json or off"<<std::endl;
+                    return false;
+                }
+            }
+            else{
+                options.max_code_length=atoi(value);
+                if(options.max_code_length<min_code_length_limit||options.max_code_length>max_code_length_limit){
+                    std::cerr<<"Maximum code length has to be between "<<min_code_length_limit<<" and "<<max_code_length_limit<<std::endl;
+                    return false;
+                }
+            }
+        }
+        else{
+            std::cerr<<"Unknown option "<<option<<std::endl;
+            return false;
+        }
+        argv+=used;
+        argc-=used;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef OUTPUT_FILE_HPP
+#define OUTPUT_FILE_HPP
+
+#include<algorithm>
+#include<cstdlib>
+#include<cstring>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/uio.h>
+
+struct output_file{
+    // collects the decoded bytes of a file in a 1 MiB buffer and hands them to write() when it is full,
+    // instead of one stdio call per block. Decoders can decode straight into the buffer:
+    // reserve(n) gives room for n bytes and commit(n) keeps them. Pieces that are given with write()
+    // and don't fit anymore go out together with the buffer in a single writev().
+    // With direct_io the file is opened with O_DIRECT (if the file system allows it), so large files
+    // don't fill the page cache: only whole multiples of 'alignment' are written from the aligned buffer,
+    // and the tail of the file is written after O_DIRECT is turned off again.
+    // One output_file can write many files one after another, the buffer is kept for the next one.
+    // If no file is open (open() failed) the bytes are dropped, so a decoder can still go through them.
+    static const size_t buffer_size=1<<20;
+    static const size_t alignment=4096;
+    int fd=-1;
+    bool direct=false;
+    bool failed=false;          // a write did not succeed (disk full for example)
+    unsigned char *buffer=NULL;
+    size_t capacity=0,used=0;
+
+    output_file(){}
+    output_file(const output_file&)=delete;
+    output_file& operator=(const output_file&)=delete;
+    ~output_file(){
+        close();
+        free(buffer);
+    }
+
+    // creates (or empties) the file, returns false if that is not possible
+    bool open(const char *path,bool direct_io=false){
+        close();
+        fd=-1;
+#ifdef O_DIRECT
+        if(direct_io)fd=::open(path,O_WRONLY|O_CREAT|O_TRUNC|O_DIRECT,0644);
+#endif
+        direct=fd>=0;
+        if(fd<0)fd=::open(path,O_WRONLY|O_CREAT|O_TRUNC,0644);
+        failed=false;
+        used=0;
+        if(fd<0)return false;
+        grow(buffer_size);
+        return true;
+    }
+
+    unsigned char *reserve(size_t n){
+        if(used+n>capacity){
+            flush();
+            if(used+n>capacity)grow(used+n);
+        }
+        return buffer+used;
+    }
+    void commit(size_t n){
+        used+=n;
+    }
+
+    void write(const unsigned char *data,size_t n){
+        if(used+n<=capacity){
+            memcpy(buffer+used,data,n);
+            used+=n;
+        }
+        else if(direct){        // everything has to go through the aligned buffer
+            while(n){
+                if(used==capacity)flush();
+                size_t m=std::min(n,capacity-used);
+                memcpy(buffer+used,data,m);
+                used+=m;
+                data+=m;
+                n-=m;
+            }
+        }
+        else{
+            struct iovec pieces[2]={{buffer,used},{(void*)data,n}};
+            ssize_t done=fd>=0?writev(fd,pieces,2):0;
+            if(done<0)done=0;
+            if((size_t)done<used){      // the rest goes out with plain writes
+                write_all(buffer+done,used-done);
+                write_all(data,n);
+            }
+            else{
+                write_all(data+(done-used),n-(done-used));
+            }
+            used=0;
+        }
+    }
+
+    // writes what is inside the buffer (direct files keep the part that is not a whole multiple of alignment)
+    void flush(){
+        size_t n=direct?used/alignment*alignment:used;
+        write_all(buffer,n);
+        memmove(buffer,buffer+n,used-n);
+        used-=n;
+    }
+
+    // writes the rest and closes the file, returns false if anything could not be written
+    bool close(){
+        if(fd<0)return !failed;
+        flush();
+#ifdef O_DIRECT
+        if(used){       // the tail of a direct file
+            fcntl(fd,F_SETFL,fcntl(fd,F_GETFL)&~O_DIRECT);
+            direct=false;
+            flush();
+        }
+#endif
+        if(::close(fd))failed=true;
+        fd=-1;
+        return !failed;
+    }
+
+    void write_all(const unsigned char *data,size_t n){
+        while(n&&!failed&&fd>=0){
+            ssize_t done=::write(fd,data,n);
+            if(done<=0){
+                failed=true;
+                break;
+            }
+            data+=done;
+            n-=done;
+        }
+    }
+
+    void grow(size_t n){
+        if(n<=capacity)return;
+        n=(n+alignment-1)/alignment*alignment;
+        void *p=NULL;
+        if(posix_memalign(&p,alignment,n))abort();
+        if(used)memcpy(p,buffer,used);
+        free(buffer);
+        buffer=(unsigned char*)p;
+        capacity=n;
+    }
+};
+
+#endif
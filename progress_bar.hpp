@@ -1,32 +1,84 @@
-#include<iostream>
+#ifndef PROGRESS_BAR_HPP
+#define PROGRESS_BAR_HPP
+
+#include<atomic>
+#include<chrono>
+#include<cstdio>
+#include<string>
+#include<unistd.h>
+
+enum progress_mode{PROGRESS_OFF,PROGRESS_BAR,PROGRESS_JSON};
 
 struct progress{
-    // this struct is here for maintaining progress bar feature
-    // it doesn't have any additional function
-    // It isn't neccessary for the program
-    long int MAX=0,CURRENT=0,LAST=0;
-    int percentage=0;
-    
-    void update(){
-        if(CURRENT*100/MAX>percentage){
-            percentage=CURRENT*100/MAX;
-            BAR();
-        }
+    // reports how much of the work (MAX units, bytes) is done
+    // The counter is atomic, so every thread adds to it from its own encoding or decoding loop.
+    // An update only adds to the counter until it passes next_check, only then the clock is read,
+    // and a report is printed if 'interval' seconds passed since the last one (by one thread, the others go on).
+    //   bar:  the bar is drawn again in place with '\r' (default if stderr is a terminal)
+    //   json: one line per report {"done":...,"total":...,"percent":...,"seconds":...} for job schedulers
+    //   off:  updates return right away (default otherwise)
+    // Reports go to stderr, so they don't mix with the messages on stdout.
+    long int MAX=0;
+    progress_mode mode=isatty(2)?PROGRESS_BAR:PROGRESS_OFF;
+    std::atomic<long int> done{0},next_check{0};
+    std::atomic_flag printing=ATOMIC_FLAG_INIT;
+    std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now(),last=start;
+    const double interval=0.2;
+    bool reported=false;
+
+    // "bar", "json" or "off", returns false for anything else
+    bool set_mode(const std::string &name){
+        if(name=="bar")mode=PROGRESS_BAR;
+        else if(name=="json")mode=PROGRESS_JSON;
+        else if(name=="off")mode=PROGRESS_OFF;
+        else return false;
+        return true;
+    }
+
+    void add(long int n){
+        if(mode==PROGRESS_OFF)return;
+        long int now=done.fetch_add(n,std::memory_order_relaxed)+n;
+        if(now>=next_check.load(std::memory_order_relaxed))check(now);
     }
     void current(long int a){
-        CURRENT=a;
-        update();
+        if(mode==PROGRESS_OFF)return;
+        done.store(a,std::memory_order_relaxed);
+        if(a>=next_check.load(std::memory_order_relaxed))check(a);
+    }
+
+    // the clock is read about a thousand times during a run at most
+    void check(long int now){
+        if(printing.test_and_set(std::memory_order_acquire))return;
+        next_check.store(now+(MAX/1000>1?MAX/1000:1),std::memory_order_relaxed);
+        std::chrono::steady_clock::time_point time=std::chrono::steady_clock::now();
+        if(!reported||std::chrono::duration<double>(time-last).count()>=interval){
+            report(now,time);
+            last=time;
+            reported=true;
+        }
+        printing.clear(std::memory_order_release);
     }
-    void next(long int a){
-        CURRENT+=LAST;
-        LAST=a;
-        update();
+
+    void report(long int now,std::chrono::steady_clock::time_point time){
+        int percentage=MAX>0?(now>=MAX?100:now*100/MAX):0;
+        if(mode==PROGRESS_BAR){
+            char bar[51];
+            for(int i=0;i<50;i++)bar[i]=i<percentage/2?'#':':';
+            bar[50]=0;
+            fprintf(stderr,"\r[%s]:%%%d",bar,percentage);
+        }
+        else{
+            fprintf(stderr,"{\"done\":%ld,\"total\":%ld,\"percent\":%d,\"seconds\":%.3f}\n",
+                now,MAX,percentage,std::chrono::duration<double>(time-start).count());
+        }
     }
-    void BAR(){
-        system("clear");
-        std::cout<<'[';
-        for(int i=1;i<=percentage;i++)std::cout<<'#';
-        for(int i=1;i<=100-percentage;i++)std::cout<<':';
-        std::cout<<"]:%"<<percentage<<std::endl;
+
+    // reports 100% and ends the bar's line
+    void finish(){
+        if(mode==PROGRESS_OFF)return;
+        report(MAX>done.load()?MAX:done.load(),std::chrono::steady_clock::now());
+        if(mode==PROGRESS_BAR)fputc('\n',stderr);
     }
 };
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include<chrono>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/resource.h>
+
+/*  Per phase statistics of archive, modified_archive and extract (--stats or HUFFMAN_STATS=1)
+    A program calls phase() whenever one of its phases ends, that prints one line to stderr:
+    {"program":"archive","phase":"count","seconds":0.012,"cpu_seconds":0.011,"bytes":300008,"mb_per_s":25.00,
+     "read_calls":3,"write_calls":0,"read_bytes":300008,"write_bytes":0}
+    finish() prints the same line for the whole run with "phase":"total".
+
+    bytes               original (not compressed) bytes the phase went through, mb_per_s is calculated from it
+    cpu_seconds         user and system time of all threads, higher than seconds when OpenMP threads work together
+    read/write_calls    read and write system calls of the whole process (stdio's too) from /proc/self/io,
+    read/write_bytes    -1 where that file does not exist. The reads of /proc/self/io and the writes of these lines
+                        are not counted.
+*/
+
+struct stats_sample{
+    std::chrono::steady_clock::time_point time;
+    double cpu;
+    long int read_calls,write_calls,read_bytes,write_bytes;
+    long int own_reads,own_read_bytes,own_writes,own_write_bytes;     // done by run_stats before this sample
+};
+
+struct run_stats{
+    bool enabled=false;
+    const char *program="";
+    stats_sample start,last;
+    long int own_reads=0,own_read_bytes=0,own_writes=0,own_write_bytes=0;
+
+    // enabled by the option or by HUFFMAN_STATS (anything but "0")
+    void begin(const char *name,bool option){
+        const char *env=getenv("HUFFMAN_STATS");
+        enabled=option||(env&&*env&&strcmp(env,"0"));
+        if(!enabled)return;
+        program=name;
+        take(start);
+        last=start;
+    }
+
+    // ends the phase that started at the last call (or at begin)
+    void phase(const char *name,long int bytes){
+        if(!enabled)return;
+        stats_sample now;
+        take(now);
+        print(name,last,now,bytes);
+        last=now;
+    }
+
+    // ends the last phase and prints the whole run
+    void finish(const char *name,long int phase_bytes,long int total_bytes){
+        if(!enabled)return;
+        phase(name,phase_bytes);
+        print("total",start,last,total_bytes);
+    }
+
+    void take(stats_sample &sample){
+        sample.time=std::chrono::steady_clock::now();
+        rusage usage;
+        getrusage(RUSAGE_SELF,&usage);
+        sample.cpu=usage.ru_utime.tv_sec+usage.ru_stime.tv_sec+(usage.ru_utime.tv_usec+usage.ru_stime.tv_usec)/1e6;
+        sample.read_calls=sample.write_calls=sample.read_bytes=sample.write_bytes=-1;
+        sample.own_reads=own_reads;
+        sample.own_read_bytes=own_read_bytes;
+        sample.own_writes=own_writes;
+        sample.own_write_bytes=own_write_bytes;
+        int fd=open("/proc/self/io",O_RDONLY);
+        if(fd<0)return;
+        char text[512];
+        long int n=read(fd,text,sizeof(text)-1);
+        close(fd);
+        if(n<=0)return;
+        text[n]=0;
+        own_reads++;
+        own_read_bytes+=n;
+        for(char *line=text;line;line=strchr(line,'\n'),line=line?line+1:NULL){
+            long int *field=!strncmp(line,"rchar:",6)?&sample.read_bytes:
+                            !strncmp(line,"wchar:",6)?&sample.write_bytes:
+                            !strncmp(line,"syscr:",6)?&sample.read_calls:
+                            !strncmp(line,"syscw:",6)?&sample.write_calls:NULL;
+            if(field)*field=atol(line+6);
+        }
+    }
+
+    void print(const char *name,const stats_sample &a,const stats_sample &b,long int bytes){
+        double seconds=std::chrono::duration<double>(b.time-a.time).count();
+        bool io=a.read_calls>=0&&b.read_calls>=0;
+        int n=fprintf(stderr,"{\"program\":\"%s\",\"phase\":\"%s\",\"seconds\":%.6f,\"cpu_seconds\":%.6f,\"bytes\":%ld,\"mb_per_s\":%.2f,"
+                       "\"read_calls\":%ld,\"write_calls\":%ld,\"read_bytes\":%ld,\"write_bytes\":%ld}\n",
+                program,name,seconds,b.cpu-a.cpu,bytes,seconds>0?bytes/seconds/1e6:0.0,
+                io?b.read_calls-a.read_calls-(b.own_reads-a.own_reads):-1,
+                io?b.write_calls-a.write_calls-(b.own_writes-a.own_writes):-1,
+                io?b.read_bytes-a.read_bytes-(b.own_read_bytes-a.own_read_bytes):-1,
+                io?b.write_bytes-a.write_bytes-(b.own_write_bytes-a.own_write_bytes):-1);
+        if(n>0){
+            own_writes++;
+            own_write_bytes+=n;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef STREAM_MODE_HPP
+#define STREAM_MODE_HPP
+
+#include<iostream>
+#include<vector>
+#include<cstring>
+#include<cerrno>
+#include<fcntl.h>
+#include<unistd.h>
+#include "huffman.hpp"
+
+/*  -c (stream mode)
+    The compressors read one file ("-" or no name: stdin) and write it to stdout as a memory stream of libhuffman
+    (see huffman.hpp), extract reads such a stream and writes the original bytes to stdout.
+    The data goes through huffman_encoder / huffman_decoder piece by piece, so pipes and sockets work
+    and memory use does not depend on the length of the stream.
+    stdout carries the data in this mode, messages go to stderr.
+*/
+
+const size_t stream_read_size=1<<16;
+
+inline int open_stream_input(const char *path){
+    if(!strcmp(path,"-"))return 0;
+    return open(path,O_RDONLY);
+}
+
+// reads up to n bytes, returns 0 at the end and -1 on errors
+inline ssize_t read_stream(int fd,unsigned char *buffer,size_t n){
+    ssize_t got;
+    do{
+        got=read(fd,buffer,n);
+    }while(got<0&&errno==EINTR);
+    return got;
+}
+
+inline bool stream_output_failed(file_sink &out){
+    fflush(out.fp);
+    if(out.failed||ferror(out.fp)){
+        std::cerr<<"Output can not be written"<<std::endl;
+        return true;
+    }
+    return false;
+}
+
+inline int compress_stream(const char *path,int max_code_length,bool interleaved){
+    int fd=open_stream_input(path);
+    if(fd<0){
+        std::cerr<<path<<" file does not exist"<<std::endl;
+        return 1;
+    }
+    file_sink out(stdout);
+    huffman_encoder encoder(out,max_code_length,-1,interleaved);
+    std::vector<unsigned char> buffer(stream_read_size);
+    ssize_t n;
+    while((n=read_stream(fd,&buffer[0],buffer.size()))>0){
+        encoder.push(&buffer[0],n);
+    }
+    if(fd)close(fd);
+    if(n<0){
+        std::cerr<<path<<" can not be read"<<std::endl;
+        return 1;
+    }
+    encoder.finish();
+    return stream_output_failed(out)?1:0;
+}
+
+inline int extract_stream(const char *path){
+    int fd=open_stream_input(path);
+    if(fd<0){
+        std::cerr<<path<<" does not exist"<<std::endl;
+        return 1;
+    }
+    file_sink out(stdout);
+    huffman_decoder decoder(out);
+    std::vector<unsigned char> buffer(stream_read_size);
+    ssize_t n;
+    bool valid=true;
+    while(valid&&(n=read_stream(fd,&buffer[0],buffer.size()))>0){
+        valid=decoder.push(&buffer[0],n);
+    }
+    if(fd)close(fd);
+    if(valid&&n<0){
+        std::cerr<<path<<" can not be read"<<std::endl;
+        return 1;
+    }
+    if(stream_output_failed(out))return 1;
+    if(!valid||!decoder.finish()){
+        std::cerr<<"Compressed stream is corrupted or incomplete"<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+#endif
@@ -8,10 +8,17 @@
 #include <vector>
 #include <algorithm>
 #include <iomanip>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "archive_reader.hpp"
 
+int run_compressor(const char *program, const char *input_file, const char *output_file,
+                   const std::vector<const char *> &options = std::vector<const char *>());
 void compress_original(const char *input_file, const char *output_file, double &time_taken);
 void compress_modified(const char *input_file, const char *output_file, double &time_taken);
 bool compare_files(const char *file1, const char *file2);
+bool check_entry(const char *archive_file, const char *input_file);
+bool check_deep_codes();
 std::string get_base_name(const char *file_path);
 long get_file_size(const char *file_path);
 
@@ -30,6 +37,7 @@ int main(int argc, char *argv[])
   std::vector<long> original_sizes;
   std::vector<long> modified_sizes;
   std::vector<long> input_sizes;
+  bool failed = false;
 
   for (int i = 1; i < argc; ++i)
   {
@@ -74,6 +82,28 @@ int main(int argc, char *argv[])
     {
       std::cout << "Test file: " << input_file << " - Compressed files differ." << std::endl;
     }
+
+    // Take the file back out of the archive without the extractor
+    if (check_entry(output_original.c_str(), input_file))
+    {
+      std::cout << "Test file: " << input_file << " - Entry read from the archive matches the input." << std::endl;
+    }
+    else
+    {
+      std::cout << "Test file: " << input_file << " - Entry read from the archive DOES NOT match the input." << std::endl;
+      failed = true;
+    }
+  }
+
+  // Codes longer than the lookup table, which the inputs above may not have
+  if (check_deep_codes())
+  {
+    std::cout << "Deep codes: entries read from the archives match the input." << std::endl;
+  }
+  else
+  {
+    std::cout << "Deep codes: entries read from the archives DO NOT match the input." << std::endl;
+    failed = true;
   }
 
   // Output detailed report
@@ -104,73 +134,51 @@ int main(int argc, char *argv[])
               << std::setw(15) << compression_ratio_modified << std::endl;
   }
 
-  return 0;
+  return failed ? 1 : 0;
+}
+
+// Runs a compressor without a shell: the options answer its questions and name the output file
+int run_compressor(const char *program, const char *input_file, const char *output_file,
+                   const std::vector<const char *> &options)
+{
+  std::vector<const char *> args = {program, "--no-confirm", "-o", output_file};
+  args.insert(args.end(), options.begin(), options.end());
+  args.push_back(input_file);
+  args.push_back(NULL);
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    execv(program, (char *const *)&args[0]);
+    _exit(127);
+  }
+  int status = 0;
+  if (pid < 0 || waitpid(pid, &status, 0) < 0)
+    return -1;
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
 }
 
 void compress_original(const char *input_file, const char *output_file, double &time_taken)
 {
   double start_time = omp_get_wtime();
-
-  // Write the inputs to a temporary file
-  std::string temp_input_file = "temp_input.txt";
-  std::ofstream temp_input(temp_input_file);
-  temp_input << "0\n1\n";
-  temp_input.close();
-
-  // Use input redirection to supply inputs to the compressor
-  std::string command = "./archive \"" + std::string(input_file) + "\" < " + temp_input_file;
-  int ret = system(command.c_str());
-
-  // Remove the temporary input file
-  std::remove(temp_input_file.c_str());
-
+  int ret = run_compressor("./archive", input_file, output_file);
   double end_time = omp_get_wtime();
   time_taken = end_time - start_time;
   if (ret != 0)
   {
     std::cerr << "Error running original compressor on " << input_file << std::endl;
   }
-  else
-  {
-    // The output file is input_file + ".compressed"
-    std::string compressed_file = std::string(input_file) + ".compressed";
-    // Rename or copy the compressed file to output_file
-    std::string copy_command = "mv \"" + compressed_file + "\" \"" + output_file + "\"";
-    system(copy_command.c_str());
-  }
 }
 
 void compress_modified(const char *input_file, const char *output_file, double &time_taken)
 {
   double start_time = omp_get_wtime();
-
-  // Write the inputs to a temporary file
-  std::string temp_input_file = "temp_input.txt";
-  std::ofstream temp_input(temp_input_file);
-  temp_input << "0\n1\n";
-  temp_input.close();
-
-  // Use input redirection to supply inputs to the compressor
-  std::string command = "./modified_archive \"" + std::string(input_file) + "\" < " + temp_input_file;
-  int ret = system(command.c_str());
-
-  // Remove the temporary input file
-  std::remove(temp_input_file.c_str());
-
+  int ret = run_compressor("./modified_archive", input_file, output_file);
   double end_time = omp_get_wtime();
   time_taken = end_time - start_time;
   if (ret != 0)
   {
     std::cerr << "Error running modified compressor on " << input_file << std::endl;
   }
-  else
-  {
-    // The output file is input_file + ".compressed"
-    std::string compressed_file = std::string(input_file) + ".compressed";
-    // Rename or copy the compressed file to output_file
-    std::string copy_command = "mv \"" + compressed_file + "\" \"" + output_file + "\"";
-    system(copy_command.c_str());
-  }
 }
 
 bool compare_files(const char *file1, const char *file2)
@@ -188,6 +196,75 @@ bool compare_files(const char *file1, const char *file2)
                     std::istreambuf_iterator<char>(f2));
 }
 
+// Decodes the input out of the archive with read_entry and extract_entry_to_file and compares both with it,
+// then checks that a truncated copy of the archive is reported as an error and leaves no output file behind
+bool check_entry(const char *archive_file, const char *input_file)
+{
+  long size = get_file_size(input_file);
+  std::ifstream input(input_file, std::ios::binary);
+  std::vector<unsigned char> original((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+  std::vector<unsigned char> data(size + 1);
+  if (size < 0 || read_entry(archive_file, input_file, &data[0], size) != size ||
+      !std::equal(original.begin(), original.end(), data.begin()))
+    return false;
+
+  std::string copy = std::string(archive_file) + ".entry";
+  bool same = extract_entry_to_file(archive_file, input_file, copy.c_str()) && compare_files(copy.c_str(), input_file);
+  remove(copy.c_str());
+  if (!same)
+    return false;
+
+  std::string truncated = std::string(archive_file) + ".truncated";
+  std::ifstream archive(archive_file, std::ios::binary);
+  std::vector<char> bytes((std::istreambuf_iterator<char>(archive)), std::istreambuf_iterator<char>());
+  std::ofstream(truncated.c_str(), std::ios::binary).write(&bytes[0], bytes.size() / 2);
+  bool rejected = read_entry(truncated.c_str(), input_file, &data[0], size) == -1 &&
+                  !extract_entry_to_file(truncated.c_str(), input_file, copy.c_str()) &&
+                  access(copy.c_str(), F_OK) != 0;
+  remove(truncated.c_str());
+  remove(copy.c_str());
+  return rejected;
+}
+
+// Compresses runs of 28 bytes with Fibonacci lengths, whose rarest codes are 27 bits and longer than the
+// 11 bit lookup table, and reads them back from
+//   a version 1 archive whose limit is above the tree depth, the archive the compressors always wrote
+//   a block mode archive and an interleaved one with the same limit
+bool check_deep_codes()
+{
+  const char *input_file = "deep_codes.bin";
+  const char *archive_file = "deep_codes.compressed";
+  {
+    std::ofstream out(input_file, std::ios::binary);
+    long a = 1, b = 1;
+    for (int i = 0; i < 28; ++i)
+    {
+      out << std::string(a, (char)('A' + i));
+      long c = a + b;
+      a = b;
+      b = c;
+    }
+  }
+  std::vector<std::vector<const char *>> formats = {{"--max-code-length", "32"},
+                                                    {"--blocks", "--max-code-length", "32"},
+                                                    {"--interleave", "--max-code-length", "32"}};
+  bool same = true;
+  for (const std::vector<const char *> &options : formats)
+  {
+    if (run_compressor("./archive", input_file, archive_file, options) != 0 || !check_entry(archive_file, input_file))
+    {
+      std::cerr << "Deep codes do not round-trip with";
+      for (const char *option : options)
+        std::cerr << " " << option;
+      std::cerr << std::endl;
+      same = false;
+    }
+    remove(archive_file);
+  }
+  remove(input_file);
+  return same;
+}
+
 std::string get_base_name(const char *file_path)
 {
   std::string path(file_path);